@@ -0,0 +1,326 @@
+#include "filesys/cache.h"
+
+#include "lib/debug.h"
+#include "lib/string.h"
+
+#include "filesys/filesys.h"
+
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+//======[ #define Macros ]===================================================
+
+/* Ticks between two runs of the write-behind thread */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* Number of sectors that can wait for the read-ahead thread */
+#define READ_AHEAD_QUEUE 32
+
+//======[ Struct Definitions ]===============================================
+
+/* A cached sector.
+   SECTOR and VALID are only changed while holding both CACHE_LOCK and the
+   entry's LOCK, so either one is enough to read them. DATA and DIRTY
+   belong to whoever holds LOCK.
+   While an evicted sector is written back, the entry already holds its new
+   SECTOR, and WRITING and OLD_SECTOR make lookups of the old one wait on
+   LOCK too. They are set under both locks and cleared under LOCK alone. */
+struct cache_entry
+{
+  block_sector_t sector;                // Sector held by this entry
+  block_sector_t old_sector;            // Sector being written back
+  bool writing;                         // DATA is being written to OLD_SECTOR
+  bool valid;                           // DATA holds the contents of SECTOR
+  bool dirty;                           // DATA differs from the disk
+  bool accessed;                        // Used since the clock hand passed
+  struct lock lock;                     // Held while DATA is in use
+  uint8_t data[BLOCK_SECTOR_SIZE];      // Cached contents
+};
+
+//======[ Global Definitions ]===============================================
+
+static struct cache_entry cache[CACHE_SIZE];
+
+/* Protects the sector to entry mapping and the clock hand */
+static struct lock cache_lock;
+
+/* Next entry examined for replacement */
+static size_t clock_hand;
+
+/* Sectors waiting to be read ahead, as a ring buffer */
+static block_sector_t ra_queue[READ_AHEAD_QUEUE];
+static size_t ra_head;                  // Oldest queued sector
+static size_t ra_cnt;                   // Number of queued sectors
+static struct lock ra_lock;             // Protects the queue
+static struct condition ra_ready;       // Signaled when RA_CNT becomes > 0
+
+//======[ Forward Declarations ]=============================================
+
+// Return the entry holding SECTOR, locked, reading it from disk if READ
+static struct cache_entry* cache_get(block_sector_t sector, bool read);
+// Pick an unlocked entry to replace
+static struct cache_entry* cache_victim(void);
+// Periodically flush the cache
+static void cache_flusher(void *aux);
+// Read queued sectors into the cache
+static void cache_reader(void *aux);
+
+//======[ Cache Methods ]====================================================
+
+// Initialize the buffer cache and start its write-behind thread
+void
+cache_init(void)
+{
+  size_t i;
+
+  lock_init(&cache_lock);
+  clock_hand = 0;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+  {
+    cache[i].valid = false;
+    cache[i].writing = false;
+    cache[i].dirty = false;
+    cache[i].accessed = false;
+    lock_init(&cache[i].lock);
+  }
+
+  lock_init(&ra_lock);
+  cond_init(&ra_ready);
+  ra_head = 0;
+  ra_cnt = 0;
+
+  thread_create("cache_flush", PRI_DEFAULT, cache_flusher, NULL);
+  thread_create("cache_read", PRI_DEFAULT, cache_reader, NULL);
+}
+
+// Write every dirty cached sector back to the file system device
+void
+cache_flush(void)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+  {
+    struct cache_entry *e = &cache[i];
+
+    lock_acquire(&e->lock);
+
+    if (e->valid && e->dirty)
+    {
+      block_write(fs_device, e->sector, e->data);
+      e->dirty = false;
+    }
+
+    lock_release(&e->lock);
+  }
+}
+
+// Flush the cache for shutdown
+void
+cache_done(void)
+{
+  cache_flush();
+}
+
+// Read the whole of SECTOR into BUFFER
+void
+cache_read(block_sector_t sector, void *buffer)
+{
+  cache_read_at(sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+// Write the whole of SECTOR from BUFFER
+void
+cache_write(block_sector_t sector, const void *buffer)
+{
+  cache_write_at(sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+// Read SIZE bytes at byte offset OFS within SECTOR into BUFFER
+void
+cache_read_at(block_sector_t sector, void *buffer, size_t ofs, size_t size)
+{
+  ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+  struct cache_entry *e = cache_get(sector, true);
+  memcpy(buffer, e->data + ofs, size);
+  lock_release(&e->lock);
+}
+
+// Write SIZE bytes from BUFFER at byte offset OFS within SECTOR.
+// A write covering the whole sector does not read it from disk first.
+void
+cache_write_at(block_sector_t sector, const void *buffer, size_t ofs,
+               size_t size)
+{
+  ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+  struct cache_entry *e = cache_get(sector, size < BLOCK_SECTOR_SIZE);
+  memcpy(e->data + ofs, buffer, size);
+  e->dirty = true;
+  lock_release(&e->lock);
+}
+
+// Queue SECTOR to be read into the cache in the background. The request is
+// dropped if the queue is full, since read-ahead is only a hint.
+void
+cache_read_ahead(block_sector_t sector)
+{
+  lock_acquire(&ra_lock);
+
+  if (ra_cnt < READ_AHEAD_QUEUE)
+  {
+    ra_queue[(ra_head + ra_cnt) % READ_AHEAD_QUEUE] = sector;
+    ra_cnt++;
+    cond_signal(&ra_ready, &ra_lock);
+  }
+
+  lock_release(&ra_lock);
+}
+
+//======[ Static Helpers ]===================================================
+
+// Return the entry holding SECTOR with its lock held. On a miss the entry
+// is filled from disk if READ is true, and left as garbage otherwise, for
+// the caller to overwrite completely.
+static struct cache_entry*
+cache_get(block_sector_t sector, bool read)
+{
+  struct cache_entry *e;
+  bool write_back;
+  size_t i;
+
+  for (;;)
+  {
+    lock_acquire(&cache_lock);
+
+    for (i = 0; i < CACHE_SIZE; i++)
+    {
+      if (cache[i].valid && (cache[i].sector == sector
+                             || (cache[i].writing
+                                 && cache[i].old_sector == sector)))
+        break;
+    }
+
+    if (i < CACHE_SIZE)
+    {
+      // Hit: the entry may be replaced while we wait for its lock, in which
+      // case look it up again. So is a sector still being written back,
+      // which the disk holds once the lock is released.
+      e = &cache[i];
+      lock_release(&cache_lock);
+      lock_acquire(&e->lock);
+
+      if (e->valid && e->sector == sector)
+      {
+        e->accessed = true;
+        return e;
+      }
+
+      lock_release(&e->lock);
+      continue;
+    }
+
+    // Miss: publish the new sector while still holding CACHE_LOCK. A dirty
+    // victim is written back without it, so that other lookups go on.
+    e = cache_victim();
+    write_back = e->valid && e->dirty;
+
+    if (write_back)
+    {
+      e->old_sector = e->sector;
+      e->writing = true;
+    }
+
+    e->sector = sector;
+    e->valid = true;
+    e->dirty = false;
+    e->accessed = true;
+    lock_release(&cache_lock);
+
+    // Others looking for either sector now wait on the entry lock, until
+    // the old one is on disk and the new one is read
+    if (write_back)
+    {
+      block_write(fs_device, e->old_sector, e->data);
+      e->writing = false;
+    }
+
+    if (read)
+      block_read(fs_device, sector, e->data);
+
+    return e;
+  }
+}
+
+// Pick an entry to replace with the clock algorithm, skipping entries in
+// use and giving recently used ones a second chance. Return it locked.
+// Must be called with CACHE_LOCK held.
+static struct cache_entry*
+cache_victim(void)
+{
+  ASSERT(lock_held_by_current_thread(&cache_lock));
+
+  for (;;)
+  {
+    struct cache_entry *e = &cache[clock_hand];
+    clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+    if (!e->valid)
+    {
+      lock_acquire(&e->lock);
+      return e;
+    }
+
+    if (e->lock.holder != NULL)
+      continue;
+
+    if (e->accessed)
+    {
+      e->accessed = false;
+      continue;
+    }
+
+    // Only blocks if the entry was grabbed since the check above; its
+    // holder never needs CACHE_LOCK to release it
+    lock_acquire(&e->lock);
+    return e;
+  }
+}
+
+// Write dirty sectors back every FLUSH_INTERVAL ticks, so that a crash
+// loses little data even if they are never evicted
+static void
+cache_flusher(void *aux UNUSED)
+{
+  for (;;)
+  {
+    timer_sleep(FLUSH_INTERVAL);
+    cache_flush();
+  }
+}
+
+// Read queued sectors into the cache one at a time. Readers reaching a
+// sector that is still being fetched wait on its entry lock, so the disk
+// works ahead of them instead of in step with them.
+static void
+cache_reader(void *aux UNUSED)
+{
+  for (;;)
+  {
+    lock_acquire(&ra_lock);
+
+    while (ra_cnt == 0)
+      cond_wait(&ra_ready, &ra_lock);
+
+    block_sector_t sector = ra_queue[ra_head];
+    ra_head = (ra_head + 1) % READ_AHEAD_QUEUE;
+    ra_cnt--;
+    lock_release(&ra_lock);
+
+    struct cache_entry *e = cache_get(sector, true);
+    lock_release(&e->lock);
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stddef.h>
+#include "devices/block.h"
+
+//======[ #define Macros ]===================================================
+
+/* Number of sectors held by the buffer cache */
+#define CACHE_SIZE 64
+
+//======[ Forward Declarations ]=============================================
+
+// Initialize the buffer cache and start its write-behind thread
+void cache_init(void);
+// Write every dirty cached sector back to the file system device
+void cache_flush(void);
+// Flush the cache for shutdown
+void cache_done(void);
+
+// Read the whole of SECTOR into BUFFER
+void cache_read(block_sector_t sector, void *buffer);
+// Write the whole of SECTOR from BUFFER
+void cache_write(block_sector_t sector, const void *buffer);
+// Read SIZE bytes at byte offset OFS within SECTOR into BUFFER
+void cache_read_at(block_sector_t sector, void *buffer, size_t ofs,
+                   size_t size);
+// Write SIZE bytes from BUFFER at byte offset OFS within SECTOR
+void cache_write_at(block_sector_t sector, const void *buffer, size_t ofs,
+                    size_t size);
+// Queue SECTOR to be read into the cache in the background
+void cache_read_ahead(block_sector_t sector);
+
+#endif /* filesys/cache.h */
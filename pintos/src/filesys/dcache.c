@@ -0,0 +1,206 @@
+#include "filesys/dcache.h"
+
+#include "lib/debug.h"
+#include "lib/string.h"
+#include "lib/kernel/hash.h"
+#include "lib/kernel/list.h"
+
+#include "filesys/directory.h"
+
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+//======[ Struct Definitions ]===============================================
+
+/* A cached name lookup, positive or negative */
+struct dentry
+{
+  struct hash_elem hash_elem;           // Element in DENTRIES
+  struct list_elem lru_elem;            // Element in LRU
+  block_sector_t parent;                // Inode sector of the directory
+  char name[NAME_MAX + 1];              // Name looked up in it
+  bool found;                           // NAME exists in PARENT
+  struct dir_entry entry;               // Its entry, if FOUND
+  off_t ofs;                            // Byte offset of ENTRY, if FOUND
+};
+
+//======[ Global Definitions ]===============================================
+
+static struct hash dentries;            // Cached lookups by (parent, name)
+static struct list lru;                 // Cached lookups, most recent first
+static struct lock dcache_lock;         // Protects all of the above
+
+//======[ Forward Declarations ]=============================================
+
+static unsigned dentry_hash(const struct hash_elem *e, void *aux);
+static bool dentry_less(const struct hash_elem *a, const struct hash_elem *b,
+                        void *aux);
+// Return the cached lookup of NAME in PARENT, or NULL
+static struct dentry* dentry_find(block_sector_t parent, const char *name);
+// Drop the cached lookup D
+static void dentry_remove(struct dentry *d);
+
+//======[ Cache Methods ]====================================================
+
+// Initialize the directory entry cache
+void
+dcache_init(void)
+{
+  hash_init(&dentries, dentry_hash, dentry_less, NULL);
+  list_init(&lru);
+  lock_init(&dcache_lock);
+}
+
+// Look up NAME in the directory whose inode is at PARENT. Return false if
+// the cache does not know. Otherwise set *FOUND to whether NAME exists, and
+// if it does, copy its entry into *EP and its byte offset into *OFSP.
+bool
+dcache_lookup(block_sector_t parent, const char *name, struct dir_entry *ep,
+              off_t *ofsp, bool *found)
+{
+  lock_acquire(&dcache_lock);
+  struct dentry *d = dentry_find(parent, name);
+
+  if (d != NULL)
+  {
+    *found = d->found;
+
+    if (d->found)
+    {
+      *ep = d->entry;
+      *ofsp = d->ofs;
+    }
+
+    // Move to the front of the LRU list
+    list_remove(&d->lru_elem);
+    list_push_front(&lru, &d->lru_elem);
+  }
+
+  lock_release(&dcache_lock);
+  return d != NULL;
+}
+
+// Remember that NAME in PARENT is the entry EP at byte offset OFS, or that
+// NAME does not exist if EP is NULL. The least recently used lookup makes
+// room if the cache is full.
+void
+dcache_insert(block_sector_t parent, const char *name,
+              const struct dir_entry *ep, off_t ofs)
+{
+  if (strlen(name) > NAME_MAX)
+    return;
+
+  lock_acquire(&dcache_lock);
+  struct dentry *d = dentry_find(parent, name);
+
+  if (d != NULL)
+    list_remove(&d->lru_elem);
+  else
+  {
+    if (hash_size(&dentries) >= DCACHE_SIZE)
+      dentry_remove(list_entry(list_back(&lru), struct dentry, lru_elem));
+
+    d = malloc(sizeof * d);
+
+    if (d == NULL)
+    {
+      lock_release(&dcache_lock);
+      return;
+    }
+
+    d->parent = parent;
+    strlcpy(d->name, name, sizeof d->name);
+    hash_insert(&dentries, &d->hash_elem);
+  }
+
+  d->found = (ep != NULL);
+
+  if (ep != NULL)
+  {
+    d->entry = *ep;
+    d->ofs = ofs;
+  }
+
+  list_push_front(&lru, &d->lru_elem);
+  lock_release(&dcache_lock);
+}
+
+// Forget NAME in PARENT
+void
+dcache_invalidate(block_sector_t parent, const char *name)
+{
+  lock_acquire(&dcache_lock);
+  struct dentry *d = dentry_find(parent, name);
+
+  if (d != NULL)
+    dentry_remove(d);
+
+  lock_release(&dcache_lock);
+}
+
+// Forget every name in PARENT, when its entries move or it is removed
+void
+dcache_invalidate_dir(block_sector_t parent)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire(&dcache_lock);
+
+  for (e = list_begin(&lru); e != list_end(&lru); e = next)
+  {
+    struct dentry *d = list_entry(e, struct dentry, lru_elem);
+    next = list_next(e);
+
+    if (d->parent == parent)
+      dentry_remove(d);
+  }
+
+  lock_release(&dcache_lock);
+}
+
+//======[ Static Helpers ]===================================================
+
+static unsigned
+dentry_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry(e, struct dentry, hash_elem);
+  return hash_string(d->name) ^ hash_int(d->parent);
+}
+
+static bool
+dentry_less(const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  const struct dentry *da = hash_entry(a, struct dentry, hash_elem);
+  const struct dentry *db = hash_entry(b, struct dentry, hash_elem);
+
+  if (da->parent != db->parent)
+    return da->parent < db->parent;
+
+  return strcmp(da->name, db->name) < 0;
+}
+
+// Return the cached lookup of NAME in PARENT, or NULL
+static struct dentry*
+dentry_find(block_sector_t parent, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  if (strlen(name) > NAME_MAX)
+    return NULL;
+
+  key.parent = parent;
+  strlcpy(key.name, name, sizeof key.name);
+  e = hash_find(&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry(e, struct dentry, hash_elem) : NULL;
+}
+
+// Drop the cached lookup D
+static void
+dentry_remove(struct dentry *d)
+{
+  hash_delete(&dentries, &d->hash_elem);
+  list_remove(&d->lru_elem);
+  free(d);
+}
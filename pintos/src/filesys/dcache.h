@@ -0,0 +1,34 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+struct dir_entry;
+
+//======[ #define Macros ]===================================================
+
+/* Number of names kept by the directory entry cache */
+#define DCACHE_SIZE 256
+
+//======[ Forward Declarations ]=============================================
+
+// Initialize the directory entry cache
+void dcache_init(void);
+
+// Look up NAME in the directory whose inode is at PARENT. Return false if
+// the cache does not know. Otherwise set *FOUND to whether NAME exists, and
+// if it does, copy its entry into *EP and its byte offset into *OFSP.
+bool dcache_lookup(block_sector_t parent, const char *name,
+                   struct dir_entry *ep, off_t *ofsp, bool *found);
+// Remember that NAME in PARENT is the entry EP at byte offset OFS, or that
+// NAME does not exist if EP is NULL
+void dcache_insert(block_sector_t parent, const char *name,
+                   const struct dir_entry *ep, off_t ofs);
+// Forget NAME in PARENT
+void dcache_invalidate(block_sector_t parent, const char *name);
+// Forget every name in PARENT
+void dcache_invalidate_dir(block_sector_t parent);
+
+#endif /* filesys/dcache.h */
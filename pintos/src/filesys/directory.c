@@ -3,19 +3,26 @@
 #include "lib/stdio.h"
 #include "lib/string.h"
 #include "lib/kernel/list.h"
+#include "lib/kernel/hash.h"
 #include "lib/debug.h"
 
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/path.h"
 
 #include "threads/malloc.h"
 #include "threads/thread.h"
 
-int total_opens;
+/* Probes an insertion into a hashed directory may take before the
+   table is grown, to keep lookups short. */
+#define DIR_MAX_PROBES 8
 
-// Function to check if a string has bad characters for a directory
-bool is_path(const char *name);
+static bool dir_insert(struct dir *dir, const char *name,
+                       block_sector_t inode_sector, bool is_dir);
+static bool lookup_locked(const struct dir *dir, const char *name,
+                          struct dir_entry *ep, off_t *ofsp);
 
 /* Creates the root directory at the sector given.
    Returns true if successful, false on failure. */
@@ -32,7 +39,9 @@ dir_create_root(block_sector_t sector)
   {
     struct inode *node = inode_open(sector);
     inode_mark_dir(node);
-    block_write(fs_device, node->sector, &node->data);
+    inode_mark_hashed(node);
+    inode_set_parent(node, sector);
+    cache_write(node->sector, &node->data);
     inode_close(node);
   }
 
@@ -94,11 +103,185 @@ dir_get_inode(struct dir *dir)
   return dir->inode;
 }
 
+/* Returns the number of entry slots in DIR. */
+static size_t
+dir_slots(const struct dir *dir)
+{
+  return inode_length(dir->inode) / sizeof(struct dir_entry);
+}
+
+/* Searches the hashed directory DIR for NAME, probing at most
+   MAX_PROBES slots.  If FIND_FREE is true, looks for a free slot to
+   add NAME in instead.  Returns true and sets *OFSP to the byte
+   offset of the slot if one is found. */
+static bool
+hash_probe(const struct dir *dir, const char *name, bool find_free,
+           size_t max_probes, off_t *ofsp)
+{
+  struct dir_entry e;
+  size_t slots = dir_slots(dir);
+  size_t slot, i;
+
+  if (slots == 0)
+    return false;
+
+  slot = hash_string(name) % slots;
+
+  for (i = 0; i < slots && i < max_probes; i++)
+  {
+    off_t ofs = slot * sizeof e;
+
+    if (inode_read_at(dir->inode, &e, sizeof e, ofs) != sizeof e)
+      break;
+
+    if (find_free ? !e.in_use : e.in_use && !strcmp(name, e.name))
+    {
+      *ofsp = ofs;
+      return true;
+    }
+
+    // A slot that was never used ends the probe sequence
+    if (!find_free && !e.in_use && !e.deleted)
+      break;
+
+    slot = (slot + 1) % slots;
+  }
+
+  return false;
+}
+
+/* Rebuilds the hashed directory DIR with twice as many slots,
+   dropping the deleted markers.  Returns true if successful. */
+static bool
+dir_rehash(struct dir *dir)
+{
+  size_t old_slots = dir_slots(dir);
+  size_t new_slots = old_slots > 0 ? old_slots * 2 : DIR_MAX_PROBES;
+  struct dir_entry *old = malloc(old_slots * sizeof *old);
+  struct dir_entry *new = calloc(new_slots, sizeof *new);
+  off_t old_size = old_slots * sizeof *old;
+  off_t new_size = new_slots * sizeof *new;
+  bool success = false;
+  size_t i;
+
+  if ((old == NULL && old_slots > 0) || new == NULL)
+    goto done;
+
+  if (inode_read_at(dir->inode, old, old_size, 0) != old_size)
+    goto done;
+
+  for (i = 0; i < old_slots; i++)
+  {
+    if (old[i].in_use)
+    {
+      size_t slot = hash_string(old[i].name) % new_slots;
+
+      while (new[slot].in_use)
+        slot = (slot + 1) % new_slots;
+
+      new[slot] = old[i];
+    }
+  }
+
+  success = inode_write_at(dir->inode, new, new_size, 0) == new_size;
+
+  /* Every entry may have moved. */
+  dcache_invalidate_dir(inode_get_inumber(dir->inode));
+
+done:
+  free(old);
+  free(new);
+  return success;
+}
+
+/* Writes an entry for NAME, a file or directory at INODE_SECTOR
+   depending on IS_DIR, into a free slot of DIR.  NAME must not be
+   in DIR yet.  Returns true if successful.
+   The caller must hold DIR's directory lock. */
+static bool
+dir_insert(struct dir *dir, const char *name, block_sector_t inode_sector,
+           bool is_dir)
+{
+  struct dir_entry e;
+  off_t ofs;
+
+  ASSERT(lock_held_by_current_thread(&dir->inode->dir_lock));
+
+  if (inode_is_hashed(dir->inode))
+  {
+    /* Grow the table if NAME's probe sequence is crowded, after
+       which any free slot will do. */
+    if (!hash_probe(dir, name, true, DIR_MAX_PROBES, &ofs)
+        && (!dir_rehash(dir)
+            || !hash_probe(dir, name, true, dir_slots(dir), &ofs)))
+      return false;
+  }
+  else
+  {
+    /* Set OFS to offset of free slot.
+       If there are no free slots, then it will be set to the
+       current end-of-file.
+
+       inode_read_at() will only return a short read at end of file.
+       Otherwise, we'd need to verify that we didn't get a short
+       read due to something intermittent such as low memory. */
+    for (ofs = 0; inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
+         ofs += sizeof e)
+      if (!e.in_use)
+        break;
+  }
+
+  /* Write slot. */
+  e.in_use = true;
+  e.is_dir = is_dir;
+  e.deleted = false;
+  strlcpy(e.name, name, sizeof e.name);
+  e.inode_sector = inode_sector;
+
+  if (inode_write_at(dir->inode, &e, sizeof e, ofs) != sizeof e)
+  {
+    dcache_invalidate(inode_get_inumber(dir->inode), name);
+    return false;
+  }
+
+  dcache_insert(inode_get_inumber(dir->inode), name, &e, ofs);
+  return true;
+}
+
+/* Reads DIR for a file with the given NAME, storing its entry in
+   *EP and the entry's byte offset in *OFSP.  Returns true if one
+   exists.  Hashed directories are probed, others are scanned
+   linearly. */
+static bool
+dir_search(const struct dir *dir, const char *name,
+           struct dir_entry *ep, off_t *ofsp)
+{
+  struct inode *node = dir->inode;
+  off_t ofs;
+
+  if (inode_is_hashed(node)) {
+    return hash_probe(dir, name, false, dir_slots(dir), ofsp)
+           && inode_read_at(node, ep, sizeof *ep, *ofsp) == sizeof *ep;
+  }
+
+  for (ofs = 0; inode_read_at(node, ep, sizeof *ep, ofs) == sizeof *ep;
+       ofs += sizeof *ep) {
+    if (ep->in_use && !strcmp(name, ep->name)) {
+      *ofsp = ofs;
+      return true;
+    }
+  }
+
+  return false;
+}
+
 /* Searches DIR for a file with the given NAME.
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
    directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   otherwise, returns false and ignores EP and OFSP.
+   Results, including misses, are kept in the directory entry
+   cache, so repeated lookups do not read the directory. */
 bool
 lookup(const struct dir *dir, const char *name,
        struct dir_entry *ep, off_t *ofsp)
@@ -108,185 +291,259 @@ lookup(const struct dir *dir, const char *name,
   }
 
   struct dir_entry e;
-  size_t ofs;
+  off_t ofs;
+  bool found;
 
   ASSERT(dir != NULL);
   ASSERT(name != NULL);
 
-  struct inode *node = dir->inode;
-
-  for (ofs = 0; inode_read_at(node, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) {
-    if (e.in_use && !strcmp(name, e.name)) {
+  /* Hits need no directory lock: changes update the cache as
+     they update the directory. */
+  if (dcache_lookup(inode_get_inumber(dir->inode), name, &e, &ofs, &found)) {
+    if (found) {
       if (ep != NULL)
         *ep = e;
 
       if (ofsp != NULL)
         *ofsp = ofs;
-
-      return true;
     }
+
+    return found;
   }
 
-  return false;
+  lock_acquire(&dir->inode->dir_lock);
+  found = lookup_locked(dir, name, ep, ofsp);
+  lock_release(&dir->inode->dir_lock);
+  return found;
+}
+
+/* Same as lookup(), for a caller holding DIR's directory lock.
+   The lock keeps the directory from changing between reading it
+   and caching the result, so that a stale miss cannot hide an
+   entry added meanwhile. */
+static bool
+lookup_locked(const struct dir *dir, const char *name,
+              struct dir_entry *ep, off_t *ofsp)
+{
+  struct dir_entry e;
+  off_t ofs;
+  bool found;
+
+  ASSERT(lock_held_by_current_thread(&dir->inode->dir_lock));
+
+  if (!path_isvalid(name)) {
+    return 0;
+  }
+
+  block_sector_t parent = inode_get_inumber(dir->inode);
+
+  if (!dcache_lookup(parent, name, &e, &ofs, &found)) {
+    found = dir_search(dir, name, &e, &ofs);
+    dcache_insert(parent, name, found ? &e : NULL, ofs);
+  }
+
+  if (found) {
+    if (ep != NULL)
+      *ep = e;
+
+    if (ofsp != NULL)
+      *ofsp = ofs;
+  }
+
+  return found;
+}
+
+/* Opens the directory that resolving PATH starts from: the root
+   for an absolute PATH, and the current directory otherwise. */
+static struct dir *
+dir_open_start(const char *path)
+{
+  struct thread *t = thread_current();
+
+  if (path[0] == '/' || t->cwd == NULL)
+    return dir_open_root();
+
+  return dir_reopen(t->cwd);
+}
+
+/* Closes DIR and opens its entry NAME, which must be a directory.
+   "." stays in DIR and ".." goes to its parent.  Returns a null
+   pointer if there is no such directory. */
+static struct dir *
+dir_step(struct dir *dir, const char *name)
+{
+  struct dir_entry e;
+  struct dir *next;
+
+  if (path_isdot(name))
+    return dir;
+
+  if (path_isdotdot(name))
+    next = dir_open(inode_open(inode_get_parent(dir->inode)));
+  else if (lookup(dir, name, &e, NULL) && e.is_dir)
+    next = dir_open(inode_open(e.inode_sector));
+  else
+    next = NULL;
+
+  dir_close(dir);
+  return next;
+}
+
+/* Opens the directory holding the last component of PATH, and
+   stores that component in NAME.  Relative paths start at the
+   current directory.  A PATH without components, such as "/",
+   stands for "." in its starting directory.  Returns a null
+   pointer if a directory on the way does not exist or the last
+   component is too long. */
+struct dir *
+dir_open_parent(const char *path, char name[NAME_MAX + 1])
+{
+  char tempname[PATH_MAX];
+  char *token, *next, *save_ptr;
+  struct dir *dir;
+
+  if (!path_isvalid(path) || strlen(path) >= PATH_MAX)
+    return NULL;
+
+  strlcpy(tempname, path, sizeof tempname);
+  dir = dir_open_start(path);
+  token = strtok_r(tempname, "/", &save_ptr);
+
+  if (token == NULL)
+  {
+    strlcpy(name, ".", NAME_MAX + 1);
+    return dir;
+  }
+
+  // Each step is a lookup, normally answered by the directory entry cache
+  for (next = strtok_r(NULL, "/", &save_ptr); next != NULL && dir != NULL;
+       token = next, next = strtok_r(NULL, "/", &save_ptr))
+    dir = dir_step(dir, token);
+
+  if (dir == NULL)
+    return NULL;
+
+  if (strlen(token) > NAME_MAX)
+  {
+    dir_close(dir);
+    return NULL;
+  }
+
+  strlcpy(name, token, NAME_MAX + 1);
+  return dir;
 }
 
-/* Searches DIR for a file with the given NAME
+/* Opens the directory PATH, relative to the current directory
+   unless it is absolute.  Returns a null pointer if it does not
+   exist or is not a directory. */
+struct dir *
+dir_open_path(const char *path)
+{
+  char name[NAME_MAX + 1];
+  struct dir *dir = dir_open_parent(path, name);
+
+  return dir != NULL ? dir_step(dir, name) : NULL;
+}
+
+/* Searches for a file with the given path NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   NAME is resolved from the root or the current directory, not
+   from DIR. */
 bool
-dir_lookup(const struct dir *dir, const char *name,
+dir_lookup(const struct dir *dir UNUSED, const char *name,
            struct inode **inode)
 {
-  char *abspath = path_abspath(name);
-  ASSERT(abspath != NULL);
-  char *basename = path_basename(abspath);
-  ASSERT(basename != NULL);
-  char *dirname = path_dirname(abspath);
-  ASSERT(dirname != NULL);
-
+  char leaf[NAME_MAX + 1];
   struct dir_entry e;
-  struct dir *foo;
+  struct dir *parent = dir_open_parent(name, leaf);
+
+  *inode = NULL;
 
-  // Change to pathed directory
-  foo = dir_get_leaf(dirname);
-  if (foo == NULL) {
-    free(abspath);
+  if (parent == NULL)
     return false;
+
+  if (path_isdot(leaf) || path_isdotdot(leaf))
+  {
+    struct dir *target = dir_step(parent, leaf);
+
+    if (target != NULL)
+    {
+      *inode = inode_reopen(target->inode);
+      dir_close(target);
+    }
+
+    return *inode != NULL;
   }
 
-  if (lookup(foo, basename, &e, NULL))
+  if (lookup(parent, leaf, &e, NULL))
   {
     *inode = inode_open(e.inode_sector);
 
-    if (e.is_dir)
-      (*inode)->is_dir = 1;
-    else
-      (*inode)->is_dir = 0;
+    if (*inode != NULL)
+      (*inode)->is_dir = e.is_dir;
   }
-  else
-    *inode = NULL;
 
-  dir_close(foo);
-  free(abspath);
+  dir_close(parent);
   return *inode != NULL;
 }
 
-/* Adds a file named NAME to DIR, which must not already contain a
-   file by that name.  The file's inode is in sector
-   INODE_SECTOR.
+/* Adds a file at path NAME, which must not exist yet.  The
+   file's inode is in sector INODE_SECTOR.
    Returns true if successful, false on failure.
    Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   error occurs.
+   NAME is resolved from the root or the current directory, not
+   from DIR. */
 bool
-dir_add(struct dir *dir, const char *name, block_sector_t inode_sector)
+dir_add(struct dir *dir UNUSED, const char *name, block_sector_t inode_sector)
 {
-  char *abspath = path_abspath(name);
-  ASSERT(abspath != NULL);
-  char *dirname = path_dirname(abspath);
-  ASSERT(dirname != NULL);
-  char *basename = path_basename(abspath);
-  ASSERT(basename != NULL);
-
-//   printf("dir_add(%x, %s, %d): abspatH: %s\n", dir, name, inode_sector, abspath);
-
-  struct dir_entry e;
-  off_t ofs;
+  char leaf[NAME_MAX + 1];
+  struct dir *parent = dir_open_parent(name, leaf);
   bool success = false;
 
-  // Change to pathed directory
-  dir = dir_get_leaf(dirname);
-  if(dir == NULL) {
-    free(abspath);
+  if (parent == NULL)
     return false;
-  }
 
-  /* Check that NAME is not in use. */
-  char *obj_name = basename;
-  if (lookup(dir, obj_name, NULL, NULL))
-    goto done;
+  /* Check that NAME is not in use, and keep it that way until the
+     entry is written. */
+  lock_acquire(&parent->inode->dir_lock);
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e)
-    if (!e.in_use)
-      break;
-
-  /* Write slot. */
-  e.in_use = true;
-  e.is_dir = false;
-  strlcpy(e.name, obj_name, sizeof e.name);
-  e.inode_sector = inode_sector;
-  success = inode_write_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (!path_isdot(leaf) && !path_isdotdot(leaf)
+      && !lookup_locked(parent, leaf, NULL, NULL))
+    success = dir_insert(parent, leaf, inode_sector, false);
 
-done:
-  dir_close(dir);
-  free(abspath);
-  free(dirname);
-  free(basename);
+  lock_release(&parent->inode->dir_lock);
+  dir_close(parent);
   return success;
 }
 
-/* Removes any entry for NAME in DIR.
+/* Removes any entry for path NAME.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs only if there is no file with the given NAME, or
+   it is a directory that is open, including as some process'
+   current directory.
+   NAME is resolved from the root or the current directory, not
+   from DIR. */
 bool
-dir_remove(struct dir *dir, const char *name)
+dir_remove(struct dir *dir UNUSED, const char *name)
 {
-  char toDelete[PATH_MAX];
+  char leaf[NAME_MAX + 1];
   struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
   off_t ofs;
-  struct dir *foo = NULL;
-
-  // Change to pathed directory
-  if(is_path(name)) {
-    // We need everything but the last token, so find the last slash
-    int index = strlen(name);
-    char pathname[PATH_MAX];
-
-    while(name[index] != '/' && index > -1)
-      index--;
-    strlcpy(pathname, name, strlen(name));
-    pathname[index] = '\0';
-
-    if(strlen(pathname) == 0)
-      foo = dir_open_root();
-    else
-      foo = dir_get_leaf(pathname);
+  struct dir *parent = dir_open_parent(name, leaf);
 
-    if(foo == NULL)
-      return false;
-
-    char *token = NULL, *prevtoken = NULL, *save_ptr = NULL;
-    strlcpy(toDelete, name, PATH_MAX);
-
-    for (token = strtok_r(toDelete, "/", &save_ptr); token != NULL;
-         token = strtok_r(NULL, "/", &save_ptr))
-    {
-      prevtoken = token;
-    }
-
-    strlcpy(toDelete, prevtoken, PATH_MAX);
-  }
-  else {
-    strlcpy(toDelete, name, strlen(name) + 1);
-    foo = dir_open(inode_open(dir->inode->sector));
-  }
+  if (parent == NULL)
+    return false;
 
-  ASSERT(foo != NULL);
-  ASSERT(name != NULL);
+  lock_acquire(&parent->inode->dir_lock);
 
   /* Find directory entry. */
-  if (!lookup(foo, toDelete, &e, &ofs))
+  if (path_isdot(leaf) || path_isdotdot(leaf)
+      || !lookup_locked(parent, leaf, &e, &ofs))
     goto done;
 
   /* Open inode. */
@@ -300,11 +557,23 @@ dir_remove(struct dir *dir, const char *name)
     goto done;
   }
 
-  /* Erase directory entry. */
+  /* Erase directory entry, leaving a marker for the probes of
+     hashed directories. */
   e.in_use = false;
+  e.deleted = inode_is_hashed(parent->inode);
 
-  if (inode_write_at(foo->inode, &e, sizeof e, ofs) != sizeof e)
+  if (inode_write_at(parent->inode, &e, sizeof e, ofs) != sizeof e)
+  {
+    dcache_invalidate(inode_get_inumber(parent->inode), leaf);
     goto done;
+  }
+
+  dcache_insert(inode_get_inumber(parent->inode), leaf, NULL, 0);
+
+  /* Names cached in a removed directory must not outlive it, since
+     its sector can be reused. */
+  if (inode_is_dir(inode))
+    dcache_invalidate_dir(e.inode_sector);
 
   /* Remove inode. */
   inode_remove(inode);
@@ -312,7 +581,8 @@ dir_remove(struct dir *dir, const char *name)
 
 done:
 
-  dir_close(foo);
+  lock_release(&parent->inode->dir_lock);
+  dir_close(parent);
   inode_close(inode);
   return success;
 }
@@ -340,235 +610,78 @@ dir_readdir(struct dir *dir, char *name)
 }
 
 
-/* Creates a directory that is not root at the given sector,
-   adds the new directory to the current working directory.
-   Returns true if successful, false if already exists, bad name, etc */
+/* Adds a directory at path NAME, whose inode was created at
+   SECTOR and already marked as a directory by filesys_mkdir().
+   The inode's parent is recorded before the entry is written, so
+   no one can find the directory before it is complete.
+   Returns true if successful, false if already exists, bad name, etc
+   NAME is resolved from the root or the current directory, not
+   from DIR. */
 bool
-dir_create(struct dir *dir, const char *name, block_sector_t sector)
+dir_create(struct dir *dir UNUSED, const char *name, block_sector_t sector)
 {
-  char *abspath = path_abspath(name);
-  ASSERT(abspath != NULL);
-
-  char *dirname = path_dirname(abspath);
-  ASSERT(dirname != NULL);
-
-  char *basename = path_basename(abspath);
-  ASSERT(basename != NULL);
-
-  struct dir_entry e;
-  off_t ofs;
+  char leaf[NAME_MAX + 1];
+  struct dir *parent = dir_open_parent(name, leaf);
+  struct inode *node;
   bool success = false;
-  struct dir *foo = NULL;
 
-  // Change to pathed directory
-  foo = dir_get_leaf(dirname);
-  if (foo == NULL) {
-    free(abspath);
+  if (parent == NULL)
     return false;
-  }
 
-  /* Check that NAME is not in use. */
-  char *newdir = basename;
-  if (lookup(foo, newdir, NULL, NULL))
-    goto done;
-
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at(foo->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e)
-    if (!e.in_use)
-      break;
-
-  /* Write slot. */
-  e.in_use = true;
-  e.is_dir = true;
-  strlcpy(e.name, newdir, sizeof e.name);
-  e.inode_sector = sector;
-  success = inode_write_at(foo->inode, &e, sizeof e, ofs) == sizeof e;
+  node = inode_open(sector);
+  if (node == NULL)
+  {
+    dir_close(parent);
+    return false;
+  }
 
-done:
+  /* Check that NAME is not in use, and keep it that way until the
+     entry is written. */
+  lock_acquire(&parent->inode->dir_lock);
 
-  if (success)
+  if (!path_isdot(leaf) && !path_isdotdot(leaf)
+      && !lookup_locked(parent, leaf, NULL, NULL))
   {
-    success = inode_create(sector, BLOCK_SECTOR_SIZE);
-    struct inode *node = inode_open(sector);
-
-    inode_mark_dir(node);
-    block_write(fs_device, node->sector, &node->data);
-    inode_close(node);
+    inode_set_parent(node, inode_get_inumber(parent->inode));
+    cache_write(node->sector, &node->data);
+    success = dir_insert(parent, leaf, sector, true);
   }
 
-  free(abspath);
-  free(dirname);
-  free(basename);
+  lock_release(&parent->inode->dir_lock);
 
-  dir_close(foo);
+  inode_close(node);
+  dir_close(parent);
   return success;
 }
 
-/* Change directory */
+/* Change directory: the process keeps the directory open as its
+   current directory, so relative paths start there. */
 bool
 dir_changedir(const char *name)
 {
-  char *abspath = path_abspath(name);
-  ASSERT(abspath != NULL);
-  // Valid looking name?
-  if (!path_isvalid(name))
-    return false;
-
-  // Not pre-user threads at this point, get the thread
+  struct dir *dir = dir_open_path(name);
   struct thread *t = thread_current();
 
-  if (path_exists(abspath)) {
-    strlcpy(&t->pwd[0], abspath, sizeof(t->pwd));
-    free(abspath);
-    return true;
-  }
-  else {
-    free(abspath);
-    return false;
-  }
-}
-
-/* Go to a child directory from the current directory */
-bool
-dir_child(struct dir *current, const char *child, struct dir *retdir)
-{
-  struct dir_entry e;
-  retdir = calloc(1, sizeof(struct dir));
-
-  ASSERT(current != NULL);
-  ASSERT(child != NULL);
-
-  if (lookup(current, child, &e, NULL)) {
-    retdir->inode = inode_open(e.inode_sector);
-  }
-  else {
-    retdir = NULL;
+  if (dir == NULL)
     return false;
-  }
-
-  if (!e.is_dir) {
-    retdir = NULL;
-    return false;
-  }
 
+  dir_close(t->cwd);
+  t->cwd = dir;
   return true;
 }
 
-/* Strip string name to leaf directory starting at either cwd or root
-   return a struct dir */
-struct dir *
-dir_get_leaf(const char *name)
-{
-total_opens++;
-  if (!path_isvalid(name))
-    return NULL;
-
-  // If root, will cause other problems, so take care of first
-  if (strlen(name) == 1 && name[0] == '/')
-  {
-    return dir_open_root();
-  }
-
-  char tempname[PATH_MAX];
-  char *token, *save_ptr;
-  struct dir *tmpdir;
-  struct dir *lastdir = calloc(1, sizeof(struct dir));
-  bool enddir;
-  struct thread *t = thread_current();
-
-  strlcpy(tempname, name, strlen(name) + 1);
-
-  if (tempname[strlen(tempname) - 1] == '/')
-  {
-    enddir = true;
-  }
-  else
-  {
-    enddir = false;
-  }
- 
-  tmpdir = dir_open_root();
-  lastdir = dir_open(inode_open(tmpdir->inode->sector));
-  for (token = strtok_r(tempname, "/", &save_ptr); token != NULL;
-       token = strtok_r(NULL, "/", &save_ptr))
-  {
-    dir_close(lastdir);
-    lastdir = dir_open(inode_open(tmpdir->inode->sector));
-    dir_close(tmpdir);
-    bool success;
-    success = dir_child(lastdir, token, tmpdir);
-
-    if (!success)
-    {
-      if(strcmp(token, name))
-      {
-        // File name only, return last directory
-        return lastdir;
-      }
-      else
-      {
-        // Looked for a directory that does not exist
-        return NULL;
-      }
-    }
-  }
-
-  if (enddir) {
-    dir_close(tmpdir);
-    return lastdir;
-  }
-  else {
-    dir_close(lastdir);
-    return tmpdir;
-  }
-}
-
-/* Is name a path or just a file/dir node name */
-bool
-is_path(const char *name)
-{
-  char tempname[PATH_MAX];
-  char *save_ptr;
-  bool success = true;
-  
-  if(!path_isvalid(name))
-    success = false;
-
-  strlcpy(&tempname[0], name, strlen(name) + 1);
-  
-  // Any slashes?
-  if(strlen(strtok_r(tempname, "/", &save_ptr)) == strlen(name))
-    success = false;
-
-  return success;
-}
-
-/* Checks DIR to see if it is a parent or not (can't remove parents)
+/* Checks the directory at path NAME to see if it is a parent or not
+   (can't remove parents)
    Returns 1 if directory is empty, 0 otherwise */
 bool
 dir_is_empty(const char *name)
 {
-  if (!path_isvalid(name)) {
-    return 0;
-  }
-
-  char *abspath = path_abspath(name);
-  ASSERT(abspath != NULL);
-
-  struct dir *dir = dir_get_leaf(abspath);
-
+  struct dir *dir = dir_open_path(name);
   struct dir_entry e;
   size_t ofs;
 
-  ASSERT(dir != NULL);
-  ASSERT(name != NULL);
+  if (dir == NULL)
+    return false;
 
   for (ofs = 0; inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e)
@@ -576,12 +689,10 @@ dir_is_empty(const char *name)
     if (e.in_use)
     {
       dir_close(dir);
-      free(abspath);
       return false;
     }
   }
 
   dir_close(dir);
-  free(abspath);
   return true;
 }
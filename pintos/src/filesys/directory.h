@@ -24,13 +24,19 @@ struct dir
   off_t pos;                          /* Current position. */
 };
 
-/* A single directory entry. */
+/* A single directory entry.
+   A hashed directory is an open addressing hash table of entries,
+   probed linearly from the slot its name hashes to.  A removed
+   entry is marked DELETED so that probes go on past it, while a
+   slot that was never used ends them.  Both are free slots to a
+   linear scan, so readdir works the same on either layout. */
 struct dir_entry 
 {
   block_sector_t inode_sector;        /* Sector number of header. */
   char name[NAME_MAX + 1];            /* Null terminated file name. */
   bool in_use;                        /* In use or free? */
   bool is_dir;                        /* Is a directory? */
+  bool deleted;                       /* Removed from a hashed directory? */
 };
 
 //======[ Forward Declarations ]=============================================
@@ -43,7 +49,8 @@ struct dir *dir_open_root (void);
 struct dir *dir_reopen (struct dir *);
 void dir_close (struct dir *);
 struct inode *dir_get_inode (struct dir *);
-struct dir *dir_get_leaf(const char *name);
+struct dir *dir_open_parent(const char *path, char name[NAME_MAX + 1]);
+struct dir *dir_open_path(const char *path);
 bool dir_changedir(const char *name);
 bool dir_is_empty(const char *name);
 
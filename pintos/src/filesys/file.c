@@ -6,6 +6,14 @@
 
 #include "lib/debug.h"
 
+/* Read-ahead window bounds, in sectors.  The window starts small
+   on the first sequential read and doubles on every following one,
+   staying below half of the buffer cache. */
+#define READ_AHEAD_MIN 2
+#define READ_AHEAD_MAX 32
+
+static void file_read_ahead (struct file *, off_t ofs, off_t size);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -18,6 +26,9 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ra_next = 0;
+      file->ra_end = 0;
+      file->ra_window = 0;
       return file;
     }
   else
@@ -64,6 +75,7 @@ off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  file_read_ahead (file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -161,3 +173,43 @@ file_tell (struct file *file)
   ASSERT (file != NULL);
   return file->pos;
 }
+
+/* Records that SIZE bytes were read from FILE at offset OFS, and
+   if FILE is being read sequentially, queues the sectors in its
+   read-ahead window past the read to be fetched in the
+   background. */
+static void
+file_read_ahead (struct file *file, off_t ofs, off_t size)
+{
+  if (size <= 0)
+    return;
+
+  if (ofs == file->ra_next)
+    {
+      /* Sequential: widen the window. */
+      if (file->ra_window == 0)
+        file->ra_window = READ_AHEAD_MIN;
+      else if (file->ra_window < READ_AHEAD_MAX)
+        file->ra_window *= 2;
+    }
+  else
+    {
+      /* Random: stop reading ahead until the pattern turns
+         sequential again. */
+      file->ra_window = 0;
+      file->ra_end = 0;
+    }
+
+  file->ra_next = ofs + size;
+  if (file->ra_window == 0)
+    return;
+
+  /* Only queue what earlier calls have not. */
+  off_t start = file->ra_end > file->ra_next ? file->ra_end : file->ra_next;
+  off_t end = file->ra_next + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (start < end)
+    {
+      inode_read_ahead (file->inode, end - start, start);
+      file->ra_end = end;
+    }
+}
@@ -9,6 +9,8 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/path.h"
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 
 #include "threads/thread.h"
 #include "threads/synch.h"
@@ -19,6 +21,7 @@
 struct block *fs_device;
 
 static void do_format(void);
+static bool mark_dir(block_sector_t sector);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -30,11 +33,15 @@ filesys_init(bool format)
   if (fs_device == NULL)
     PANIC("No file system device found, can't initialize file system.");
 
+  cache_init();
+  dcache_init();
   inode_init();
   free_map_init();
 
   if (format)
     do_format();
+  else if (!inode_is_current(FREE_MAP_SECTOR))
+    PANIC("File system has an old or unknown format, reformat it with -f.");
 
   free_map_open();
 }
@@ -45,6 +52,7 @@ void
 filesys_done(void)
 {
   free_map_close();
+  cache_done();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -54,12 +62,6 @@ filesys_done(void)
 bool
 filesys_create(const char *name, off_t initial_size)
 {
-  // Name is no longer implicitly checked on length below, must check
-  // at creation of call
-
-  if (strlen(name) > NAME_MAX)
-    return 0;
-
   block_sector_t inode_sector = 0;
   struct dir *dir = dir_open_root();
   bool success = (dir != NULL
@@ -86,12 +88,9 @@ filesys_open(const char *name)
   struct dir *dir = dir_open_root();
   struct inode *inode = NULL;
 
-  if (path_isroot(name)) {
-    inode = dir->inode;
-  }
-  else if (dir != NULL) {
+  // Also opens "/", "." and "..", which have no entry of their own
+  if (dir != NULL)
     dir_lookup(dir, name, &inode);
-  }
 
   dir_close(dir);
   return file_open(inode);
@@ -125,6 +124,24 @@ do_format(void)
   printf("done.\n");
 }
 
+/* Marks the new inode at SECTOR as a hashed directory, before any
+   directory entry can point to it.  Returns false if the inode
+   cannot be opened. */
+static bool
+mark_dir(block_sector_t sector)
+{
+  struct inode *node = inode_open(sector);
+
+  if (node == NULL)
+    return false;
+
+  inode_mark_dir(node);
+  inode_mark_hashed(node);
+  cache_write(node->sector, &node->data);
+  inode_close(node);
+  return true;
+}
+
 /* Creates a directory named NAME.
    Returns true if successful, false otherwise.
    Fails if a file/dir named NAME already exists,
@@ -142,6 +159,7 @@ filesys_mkdir(const char *name)
   bool success = (dir != NULL
                   && free_map_allocate(1, &inode_sector)
                   && inode_create(inode_sector, BLOCK_SECTOR_SIZE)
+                  && mark_dir(inode_sector)
                   && dir_create(dir, name, inode_sector));
 
   if (!success && inode_sector != 0)
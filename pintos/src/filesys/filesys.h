@@ -13,6 +13,9 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    off_t ra_next;              /* Where a sequential read would start. */
+    off_t ra_end;               /* End of the bytes already read ahead. */
+    int ra_window;              /* Read-ahead window in sectors, 0 if off. */
   };
 
 /* Sectors of system file inodes. */
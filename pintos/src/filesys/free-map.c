@@ -9,6 +9,7 @@
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static size_t free_map_hint;         /* Where the next scan starts. */
 
 /* Initializes the free map. */
 void
@@ -23,22 +24,36 @@ free_map_init (void)
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
+   The search starts where the last allocation ended and wraps
+   around, so successive allocations lay out sequentially without
+   rescanning the full part of the map every time.
+   Only the part of the free map file holding the changed bits
+   is written, into the buffer cache, which writes it back
+   later.
    Returns true if successful, false if not enough consecutive
    sectors were available or if the free_map file could not be
    written. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  block_sector_t sector = bitmap_scan_and_flip (free_map, free_map_hint,
+                                                cnt, false);
+  if (sector == BITMAP_ERROR && free_map_hint > 0)
+    sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !bitmap_write_range (free_map, free_map_file, sector, cnt))
     {
       bitmap_set_multiple (free_map, sector, cnt, false);
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      *sectorp = sector;
+      free_map_hint = sector + cnt;
+      if (free_map_hint >= bitmap_size (free_map))
+        free_map_hint = 0;
+    }
   return sector != BITMAP_ERROR;
 }
 
@@ -48,7 +63,7 @@ free_map_release (block_sector_t sector, size_t cnt)
 {
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  bitmap_write_range (free_map, free_map_file, sector, cnt);
 }
 
 /* Opens the free map file and reads it from disk. */
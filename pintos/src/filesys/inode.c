@@ -8,6 +8,7 @@
 
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/cache.h"
 
 #include "threads/malloc.h"
 #include "threads/synch.h"
@@ -20,17 +21,23 @@
 static struct list open_inodes;
 
 /* Semaphores */
-static struct semaphore alloc_sema;
 static struct semaphore open_sema;
 
 // A full block of all zeros
 static char zeros[BLOCK_SECTOR_SIZE];
 
+// Number of data sectors addressable by an inode with INDIRECT_LEVELS == 3
+#define MAX_SECTORS (DIRECT_CNT + PTRS_PER_SECTOR \
+                     + PTRS_PER_SECTOR * PTRS_PER_SECTOR \
+                     + PTRS_PER_SECTOR * PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
 //======[ Forward Declarations ]=============================================
 
-// Return the inode that contains byte offset POS within INODE.
-// Return NULL there is no such inode.
-static struct inode* byte_to_inode(struct inode *inode, off_t pos);
+// Allocate the sectors needed to write SIZE bytes of BUFFER at OFFSET
+static bool inode_allocate(struct inode_disk *disk, off_t offset, off_t size,
+                           const uint8_t *buffer, bool *changed);
+// Release every data and pointer block of DISK to the free map
+static void inode_free_blocks(struct inode_disk *disk);
 
 
 //======[ Methods to Set/Query Attributes of inode_ptr ]=====================
@@ -38,220 +45,344 @@ static struct inode* byte_to_inode(struct inode *inode, off_t pos);
 // Create a node pointer from a sector number
 inode_ptr ptr_create(block_sector_t sector)
 {
-  return (inode_ptr)(sector & 0x3FFF);
+  ASSERT(sector != 0);
+  return (inode_ptr)sector;
 }
 
 // Get disk sector address from inode ptr
 block_sector_t ptr_get_address(const inode_ptr *ptr)
 {
   ASSERT(ptr != NULL);
-  return (block_sector_t)((*ptr) & 0x3FFF);
+  return (block_sector_t)(*ptr);
 }
 
-// Register the pointer as having data on disk
-void ptr_set_exist(inode_ptr *ptr)
+// Return true if the pointer points to a sector
+bool ptr_exists(const inode_ptr *ptr)
 {
   ASSERT(ptr != NULL);
-  (*ptr) = (*ptr) | 0x8000;
+  return (*ptr) != 0;
 }
 
-// Return true if the meta data says the pointer exists on disk
-bool ptr_exists(const inode_ptr *ptr)
+//======[ Methods to Set/Query Attributes of inode ]=========================
+
+/** Return true if the metadata for this inode says it is a directory */
+bool inode_is_dir(struct inode* ip)
 {
-  ASSERT(ptr != NULL);
-  return ((*ptr) & 0x8000);
+  ASSERT(ip != NULL);
+  return (ip->data.flags & INODE_DIR) != 0;
 }
 
-// Set the pointer as being a directory file
-void ptr_set_isdir(inode_ptr *ptr)
+/** Return true if the metadata for this inode says it is a file */
+bool inode_is_file(struct inode* ip)
 {
-  ASSERT(ptr != NULL);
-  (*ptr) = (*ptr) | 0x4000;
+  ASSERT(ip != NULL);
+  return (ip->data.flags & INODE_DIR) == 0;
 }
 
-// Return true if the meta data says the pointer is a directory file
-bool ptr_isdir(const inode_ptr *ptr)
+/** Mark the metadata for this inode to say it is a directory */
+void inode_mark_dir(struct inode *ip)
 {
-  ASSERT(ptr != NULL);
-  return ((*ptr) & 0x4000);
+  ASSERT(ip != NULL);
+  ip->data.flags |= INODE_DIR;
 }
 
-//======[ Methods to Set/Query Attributes of inode ]=========================
+/** Return true if this directory inode keeps its entries in a hash table */
+bool inode_is_hashed(struct inode *ip)
+{
+  ASSERT(ip != NULL);
+  return (ip->data.flags & INODE_DIR_HASHED) != 0;
+}
 
-/** Return true if the metadata for this inode says it is a directory */
-bool inode_is_dir(struct inode* ip)
+/** Mark this directory inode as keeping its entries in a hash table */
+void inode_mark_hashed(struct inode *ip)
 {
   ASSERT(ip != NULL);
-  return ptr_isdir(&ip->data.self);
+  ip->data.flags |= INODE_DIR_HASHED;
 }
 
-/** Return true if the metadata for this inode says it is a file */
-bool inode_is_file(struct inode* ip)
+/** Return the sector of the directory holding this directory inode */
+block_sector_t inode_get_parent(const struct inode *ip)
 {
   ASSERT(ip != NULL);
-  return !ptr_isdir(&ip->data.self);
+  return ptr_get_address(&ip->data.parent);
 }
 
-/** Mark the metadata for this inode to say it is a directory */
-void inode_mark_dir(struct inode *ip)
+/** Record PARENT as the directory holding this directory inode */
+void inode_set_parent(struct inode *ip, block_sector_t parent)
 {
   ASSERT(ip != NULL);
-  return ptr_set_isdir(&ip->data.self);
+  ip->data.parent = ptr_create(parent);
+}
+
+/* Returns the number of sectors to allocate for an inode SIZE
+   bytes long. */
+static inline size_t
+bytes_to_sectors(off_t size)
+{
+  return DIV_ROUND_UP(size, BLOCK_SECTOR_SIZE);
 }
 
-// Allocate a single new inode, along with its data. If ON_DISK is true, also
-// allocate space on disk for the inode.
-// Return the struct inode pointer if successful, NULL otherwise
-struct inode *allocate_inode(bool on_disk)
+// Allocate a zeroed sector and point PTR to it
+static bool
+ptr_allocate(inode_ptr *ptr)
 {
-  sema_down(&alloc_sema);
-  bool success = true;
-  block_sector_t data_addr = 0;
-  struct inode *node = NULL;
+  block_sector_t sector;
 
-  if (on_disk && (!free_map_allocate(1, &data_addr)))
-  {
-    // Out of disk space
-    success = false;
-  }
+  if (!free_map_allocate(1, &sector))
+    return false;
 
-  if (success)
+  cache_write(sector, zeros);
+  *ptr = ptr_create(sector);
+  return true;
+}
+
+// Store the sector PTR points to in SECTOR. If there is none and ALLOCATE
+// is true, point PTR to the sector already in SECTOR, or to a new zeroed
+// sector if that is 0. Fail otherwise.
+static bool
+ptr_fetch(inode_ptr *ptr, bool allocate, block_sector_t *sector)
+{
+  if (!ptr_exists(ptr))
   {
-    // Either memory allocation on disk succeeded, or was unnecessary
-    // Allocate space on disk for a struct inode
-    node = malloc(sizeof * node);
+    if (!allocate)
+      return false;
 
-    if (node == NULL)
-    {
-      // Out of memory
-      success = false;
-    }
-    else
-    {
-      // So far so good
-      // Set up attributes in the node
-      node->sector = data_addr;       // Sector number of disk location.
-      node->open_cnt = 0;             // Number of openers.
-      node->removed = false;          // True if deleted, false otherwise.
-      node->deny_write_cnt = false;   // 0: writes ok, >0: deny writes.
-      node->next = NULL;              // Pointer to next inode
-      sema_init(&node->extend_sema, 1);
-
-      // Set attributes for the inode disk
-      node->data.file_length = 0;       // File length in bytes
-      node->data.prev_length = 0;       // Combined length of previous inodes
-      node->data.node_length = 0;       // Number of bytes used in this node
-      node->data.self = ptr_create(node->sector);
-      node->data.doubleptr = 0;
-      node->data.magic = INODE_MAGIC;   // Magic number
-
-      ASSERT(sizeof(node->data) == BLOCK_SECTOR_SIZE);
-    }
+    if (*sector != 0)
+      *ptr = ptr_create(*sector);
+    else if (!ptr_allocate(ptr))
+      return false;
   }
 
-  sema_up(&alloc_sema);
-  return node;
+  *sector = ptr_get_address(ptr);
+  return true;
 }
 
-block_sector_t get_next_addr(struct inode *node)
+// Same as ptr_fetch(), for pointer INDEX of the indirect block TABLE
+static bool
+table_fetch(block_sector_t table, size_t index, bool allocate,
+            block_sector_t *sector)
 {
-  ASSERT(node != NULL);
-  inode_ptr ptr = node->data.doubleptr;
+  inode_ptr ptr;
+  size_t ofs = index * sizeof ptr;
+
+  cache_read_at(table, &ptr, ofs, sizeof ptr);
 
-  if (ptr_exists(&ptr))
+  if (!ptr_exists(&ptr))
   {
-    return ptr_get_address(&ptr);
+    if (!allocate)
+      return false;
+
+    if (*sector != 0)
+      ptr = ptr_create(*sector);
+    else if (!ptr_allocate(&ptr))
+      return false;
+
+    cache_write_at(table, &ptr, ofs, sizeof ptr);
   }
-  else
+
+  *sector = ptr_get_address(&ptr);
+  return true;
+}
+
+// Store in SECTOR the disk sector holding data sector INDEX of DISK. If
+// ALLOCATE is true, missing indirect blocks on the way are allocated, and a
+// missing data sector is set to the one already in SECTOR. Otherwise fail
+// if anything is missing.
+static bool
+index_to_sector(struct inode_disk *disk, size_t index, bool allocate,
+                block_sector_t *sector)
+{
+  block_sector_t table = 0;
+  size_t span = PTRS_PER_SECTOR;        // Data sectors below this level
+  int level;
+
+  if (index < DIRECT_CNT)
+    return ptr_fetch(&disk->direct[index], allocate, sector);
+
+  index -= DIRECT_CNT;
+
+  for (level = 0; level < INDIRECT_LEVELS; level++)
   {
-    return -1;
+    if (index < span)
+    {
+      if (!ptr_fetch(&disk->indirect[level], allocate, &table))
+        return false;
+
+      // Walk down the pointer blocks to the one holding the data pointer
+      while (span > PTRS_PER_SECTOR)
+      {
+        block_sector_t next = 0;
+        span /= PTRS_PER_SECTOR;
+
+        if (!table_fetch(table, index / span, allocate, &next))
+          return false;
+
+        table = next;
+        index %= span;
+      }
+
+      return table_fetch(table, index, allocate, sector);
+    }
+
+    index -= span;
+    span *= PTRS_PER_SECTOR;
   }
+
+  // Beyond the largest possible file
+  return false;
 }
 
+/* Returns the block device sector that contains byte offset POS within INODE.
+   Returns -1 if INODE does not contain data for a byte at offset POS, either
+   because POS is past the end or because it lies in a hole. */
+static block_sector_t
+byte_to_sector(struct inode *inode, off_t pos)
+{
+  block_sector_t sector;
+
+  if (pos < 0 || pos >= inode->data.file_length)
+    return -1;
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors(off_t size)
+  if (!index_to_sector(&inode->data, pos / BLOCK_SECTOR_SIZE, false, &sector))
+    return -1;
+
+  return sector;
+}
+
+// Return true if data sector INDEX of DISK is a hole that writing SIZE
+// bytes of BUFFER at OFFSET puts data into. A NULL BUFFER stands for data
+// that is not known yet. Holes that only get zeros can stay holes.
+static bool
+needs_sector(struct inode_disk *disk, size_t index, off_t offset, off_t size,
+             const uint8_t *buffer)
 {
-  return DIV_ROUND_UP(size, BLOCK_SECTOR_SIZE);
+  block_sector_t sector;
+  off_t start = index * BLOCK_SECTOR_SIZE;
+  off_t end = start + BLOCK_SECTOR_SIZE;
+
+  if (index_to_sector(disk, index, false, &sector))
+    return false;
+
+  if (buffer == NULL)
+    return true;
+
+  if (start < offset)
+    start = offset;
+
+  if (end > offset + size)
+    end = offset + size;
+
+  for (; start < end; start++)
+  {
+    if (buffer[start - offset] != 0)
+      return true;
+  }
+
+  return false;
 }
 
-// Return the inode that contains byte offset POS within INODE.
-// Return NULL there is no such inode.
-static struct inode *
-byte_to_inode(struct inode *inode, off_t pos)
+// Allocate zeroed sectors for the holes of DISK that writing SIZE bytes of
+// BUFFER at OFFSET needs, and set CHANGED if any pointer of DISK was set.
+// Each run of adjacent holes gets contiguous sectors if the free map has
+// them, and is split in halves until it fits otherwise. On failure the
+// sectors allocated so far stay in DISK, to be released with the file.
+static bool
+inode_allocate(struct inode_disk *disk, off_t offset, off_t size,
+               const uint8_t *buffer, bool *changed)
 {
-  if (pos == -1)
-    return inode;
+  size_t index = offset / BLOCK_SECTOR_SIZE;
+  size_t last = bytes_to_sectors(offset + size);
+  block_sector_t sector;
 
-  if (inode != NULL && pos < inode->data.file_length)
+  if (last > MAX_SECTORS)
+    return false;
+
+  while (index < last)
   {
-    // If this check failed, we passed POS at some point -> doubly-linked list?
-    ASSERT(pos >= inode->data.prev_length);
+    size_t cnt = 0;
+    size_t i;
+    block_sector_t start;
 
-    // Calculate the local byte offset position that would correspond to POS
-    off_t local_pos = pos - inode->data.prev_length;
+    // Measure the run of holes at INDEX that need a sector
+    while (index + cnt < last
+           && needs_sector(disk, index + cnt, offset, size, buffer))
+      cnt++;
 
-    if (local_pos < BYTE_CAPACITY)
+    if (cnt == 0)
     {
-      // This is one of ours
-      return inode;
+      index++;
+      continue;
     }
-    else
+
+    while (!free_map_allocate(cnt, &start))
+    {
+      if (cnt == 1)
+        return false;
+
+      cnt /= 2;
+    }
+
+    for (i = 0; i < cnt; i++)
     {
-      // Not ours. Go bother the next guy.
-      if (inode->next != NULL)
+      // The zeros stay in the buffer cache until the sector is written back
+      sector = start + i;
+      cache_write(sector, zeros);
+
+      if (!index_to_sector(disk, index + i, true, &sector))
       {
-        ASSERT(inode->next != inode);
-        return byte_to_inode(inode->next, pos);
+        free_map_release(start + i, cnt - i);
+        return false;
       }
-      else
-        if (ptr_exists(&inode->data.doubleptr))
-        {
-          ASSERT(inode->sector != ptr_get_address(&inode->data.doubleptr));
-          inode->next = inode_open(ptr_get_address(&inode->data.doubleptr));
-          return byte_to_inode(inode->next, pos);
-        }
-        else
-        {
-          return NULL;
-        }
+
+      *changed = true;
     }
+
+    index += cnt;
   }
-  else
-  {
-    return NULL;
-  }
+
+  return true;
 }
 
-/* Returns the block device sector that contains byte offset POS within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset POS. */
-static block_sector_t
-byte_to_sector(struct inode *inode, off_t pos)
+// Release the sectors of the CNT pointers at PTRS, which are indirect
+// blocks holding pointers to LEVEL more levels of blocks if LEVEL > 0
+static void
+free_ptrs(const inode_ptr *ptrs, size_t cnt, int level)
 {
-  struct inode *node = byte_to_inode(inode, pos);
+  size_t i;
 
-  if (node != NULL)
+  for (i = 0; i < cnt; i++)
   {
-    // Calculate the local byte offset position that would correspond to POS
-    off_t local_pos = pos - node->data.prev_length;
+    if (!ptr_exists(&ptrs[i]))
+      continue;
 
-    inode_ptr addr = node->data.blockptrs[local_pos / BLOCK_SECTOR_SIZE];
+    block_sector_t sector = ptr_get_address(&ptrs[i]);
 
-    if (ptr_exists(&addr))
-    {
-      return ptr_get_address(&addr);
-    }
-    else
+    if (level > 0)
     {
-      return -1;
+      inode_ptr *table = malloc(BLOCK_SECTOR_SIZE);
+
+      if (table != NULL)
+      {
+        cache_read(sector, table);
+        free_ptrs(table, PTRS_PER_SECTOR, level - 1);
+        free(table);
+      }
     }
+
+    free_map_release(sector, 1);
   }
-  else
-  {
-    return -1;
-  }
+}
+
+// Release every data and pointer block of DISK to the free map
+static void
+inode_free_blocks(struct inode_disk *disk)
+{
+  int level;
+
+  free_ptrs(disk->direct, DIRECT_CNT, 0);
+
+  for (level = 0; level < INDIRECT_LEVELS; level++)
+    free_ptrs(&disk->indirect[level], 1, level + 1);
 }
 
 static struct semaphore closing_sema;
@@ -264,7 +395,6 @@ inode_init(void)
   list_init(&open_inodes);
 
   // Initialize semaphores
-  sema_init(&alloc_sema, 1);
   sema_init(&open_sema, 1);
   sema_init(&closing_sema, 1);
 }
@@ -278,28 +408,32 @@ bool
 inode_create(block_sector_t sector, off_t length)
 {
   ASSERT(length >= 0);
+  ASSERT(sizeof(struct inode_disk) == BLOCK_SECTOR_SIZE);
+
+  struct inode_disk *disk = calloc(1, sizeof * disk);
+
+  if (disk == NULL)
+    return false;
 
-  // Create the main inode
-  struct inode *main_node = allocate_inode(false);
-  main_node->sector = sector;
-  main_node->data.self = ptr_create(main_node->sector);
-  main_node->data.file_length = length;
+  disk->magic = INODE_MAGIC;
+  disk->version = INODE_VERSION;
 
-  // The last node to be allocated
-  struct inode *tail_node = inode_extend_link(main_node, length, length);
+  // Allocate the initial data up front, in as few runs as possible. Only
+  // later growth by writes leaves holes, which matters for the free map
+  // file: writing it must never need to allocate sectors.
+  bool changed = false;
+  bool success = inode_allocate(disk, 0, length, NULL, &changed);
 
-  // Check if any problem occurred
-  if (tail_node == NULL)
+  if (success)
   {
-    // Free all data blocks
-    // Free main_node
-    free(main_node);
-    return false;
+    disk->file_length = length;
+    cache_write(sector, disk);
   }
+  else
+    inode_free_blocks(disk);
 
-  // No problem occurred: write MAIN_NODE to SECTOR
-  block_write(fs_device, sector, &main_node->data);
-  return true;
+  free(disk);
+  return success;
 }
 
 /* Reads an inode from SECTOR
@@ -327,7 +461,7 @@ inode_open(block_sector_t sector)
   }
 
   /* Allocate memory. */
-  inode = allocate_inode(false);
+  inode = malloc(sizeof * inode);
 
   if (inode == NULL)
   {
@@ -343,8 +477,10 @@ inode_open(block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  inode->next = NULL;
-  block_read(fs_device, inode->sector, &inode->data);
+  sema_init(&inode->extend_sema, 1);
+  lock_init(&inode->dir_lock);
+  cache_read(inode->sector, &inode->data);
+  inode->is_dir = inode_is_dir(inode);
 
   sema_up(&open_sema);
   return inode;
@@ -378,8 +514,6 @@ inode_close(struct inode *inode)
   if (inode == NULL)
     return;
 
-  ASSERT(inode->next != inode);
-
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0)
   {
@@ -393,15 +527,12 @@ inode_close(struct inode *inode)
     /* Deallocate blocks if removed. */
     if (inode->removed)
     {
-      // TODO, Free data for entire file
+      inode_free_blocks(&inode->data);
       free_map_release(inode->sector, 1);
     }
 
     sema_up(&closing_sema);
 
-    if (inode->next != NULL && inode->next != inode)
-      inode_close(inode->next);
-
     free(inode);
   }
 }
@@ -427,7 +558,6 @@ inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset)
 
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0)
   {
@@ -446,25 +576,11 @@ inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset)
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-    {
-      /* Read full sector directly into caller's buffer. */
-      block_read(fs_device, sector_idx, buffer + bytes_read);
-    }
+    /* Copy the chunk out of the buffer cache, or zeros for a hole. */
+    if (sector_idx == (block_sector_t) -1)
+      memset(buffer + bytes_read, 0, chunk_size);
     else
-    {
-      /* Read sector into bounce buffer, then partially copy
-         into caller's buffer. */
-      if (bounce == NULL)
-      {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-
-        if (bounce == NULL)
-          break;
-      }
-      block_read(fs_device, sector_idx, bounce);
-      memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
-    }
+      cache_read_at(sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
 
     /* Advance. */
     size -= chunk_size;
@@ -472,13 +588,38 @@ inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset)
     bytes_read += chunk_size;
   }
 
-  free(bounce);
-
   sema_up(&inode->extend_sema);
 
   return bytes_read;
 }
 
+/* Queues the sectors holding SIZE bytes of INODE starting at OFFSET to
+   be read into the buffer cache in the background. Bytes past the end
+   of the file are ignored. */
+void
+inode_read_ahead(struct inode *inode, off_t size, off_t offset)
+{
+  ASSERT(inode != NULL);
+  sema_down(&inode->extend_sema);
+
+  off_t end = offset + size;
+
+  if (end > inode_length(inode))
+    end = inode_length(inode);
+
+  offset -= offset % BLOCK_SECTOR_SIZE;
+
+  for (; offset < end; offset += BLOCK_SECTOR_SIZE)
+  {
+    block_sector_t sector_idx = byte_to_sector(inode, offset);
+
+    if (sector_idx != (block_sector_t) -1)
+      cache_read_ahead(sector_idx);
+  }
+
+  sema_up(&inode->extend_sema);
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if an error occurs.nn */
@@ -491,7 +632,6 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
   ASSERT(buffer_ != NULL);
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
   {
@@ -499,16 +639,28 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
     return 0;
   }
 
-  if (size + offset > inode->data.file_length)
+  /* Allocate sectors for the holes being written only. Growing the file
+     past its end leaves the bytes in between as holes, which read as
+     zeros without taking any sector, and so do holes only written with
+     zeros. */
+  bool changed = false;
+  bool success = size <= 0
+                 || inode_allocate(&inode->data, offset, size, buffer,
+                                   &changed);
+
+  if (success && size + offset > inode->data.file_length)
   {
-    uint32_t bytes_left = (size + offset) - inode->data.file_length;
-    struct inode *tail_node = inode_extend_link(inode, bytes_left, size + offset);
+    inode->data.file_length = size + offset;
+    changed = true;
+  }
 
-    if (tail_node == NULL)
-    {
-      sema_up(&inode->extend_sema);
-      return 0;
-    }
+  if (changed)
+    cache_write(inode->sector, &inode->data);
+
+  if (!success)
+  {
+    sema_up(&inode->extend_sema);
+    return 0;
   }
 
   while (size > 0)
@@ -530,40 +682,12 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
       break;
     }
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-    {
-      /* Write full sector directly to disk. */
-      block_write(fs_device, sector_idx, buffer + bytes_written);
-    }
-    else
-    {
-      /* We need a bounce buffer. */
-
-      if (bounce == NULL)
-      {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-
-        if (bounce == NULL)
-        {
-          break;
-        }
-      }
-
-      /* If the sector contains data before or after the chunk
-         we're writing, then we need to read in the sector
-         first.  Otherwise we start with a sector of all zeros. */
-      if (sector_ofs > 0 || chunk_size < sector_left)
-      {
-        block_read(fs_device, sector_idx, bounce);
-      }
-      else
-      {
-        memset(bounce, 0, BLOCK_SECTOR_SIZE);
-      }
-
-      memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-      block_write(fs_device, sector_idx, bounce);
-    }
+    /* Copy the chunk into the buffer cache, which reads the rest of the
+       sector in first if the chunk does not cover all of it. A hole left
+       by inode_allocate() already reads as the zeros being written. */
+    if (sector_idx != (block_sector_t) -1)
+      cache_write_at(sector_idx, buffer + bytes_written, sector_ofs,
+                     chunk_size);
 
     /* Advance. */
     size -= chunk_size;
@@ -571,7 +695,6 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
     bytes_written += chunk_size;
   }
 
-  free(bounce);
   sema_up(&inode->extend_sema);
   return bytes_written;
 }
@@ -596,142 +719,27 @@ inode_allow_write(struct inode *inode)
   inode->deny_write_cnt--;
 }
 
-/* Returns the length, in bytes, of INODE's data. */
-off_t
-inode_length(const struct inode *inode)
-{
-  return inode->data.file_length;
-}
-
-// Extend an inode by BYTES_LEFT.
-// Returns the last node allocated (i.e. the tail) if successful. NULL otherwise
-struct inode *
-inode_extend_link(struct inode *prev_node, uint32_t bytes_left, uint32_t length)
+/* Returns true if the inode at SECTOR has the current on-disk
+   format. */
+bool
+inode_is_current(block_sector_t sector)
 {
-  ASSERT(prev_node != NULL);
-
-  // Check if something went wrong trying to fill up PREV_NODE
-  if (!inode_fill(prev_node, &bytes_left, length))
-  {
-    return NULL;
-  }
-
-  // Check if there's nothing more to allocate
-  if (bytes_left <= 0)
-  {
-    return prev_node;
-  }
-
-  // Attempt to allocate a new node
-  struct inode *current_node = allocate_inode(true);
-
-  // Check if allocation failed
-  if (current_node == NULL)
-  {
-    return NULL;
-  }
-
-  // Successfully allocated disk space for subsequent INODE
-  // Quick check against circularity
-  ASSERT(current_node != prev_node);
-
-  // Check if there's any problem allocating data to fill up this node
-  if (!inode_fill(current_node, &bytes_left, length))
-  {
-    // Free all allocated pages
-
-    // Free the current node, return NULL
-    free(current_node);
-
-    return NULL;
-  }
-
-
-  // Successfully filled up this node
-
-  // Link the previous node to the current node
-  if (prev_node != NULL)
-  {
-    prev_node->next = current_node;
-    prev_node->data.doubleptr = ptr_create(current_node->sector);
-    ptr_set_exist(&prev_node->data.doubleptr);
-  }
+  struct inode_disk *disk = malloc(sizeof * disk);
+  bool current = false;
 
-  // Continue extending and linking
-  struct inode *node = inode_extend_link(current_node, bytes_left, length);
-
-  // Check if something came unravelled down the line
-  if (node == NULL)
+  if (disk != NULL)
   {
-    // Free allocated data blocks
-
-    // Free inode
-    free(current_node);
-
-    return NULL;
+    cache_read(sector, disk);
+    current = disk->magic == INODE_MAGIC && disk->version == INODE_VERSION;
+    free(disk);
   }
 
-  // Everything is OK: finalize by writing to disk and return
-  // Update lengths of this node
-  current_node->data.file_length = prev_node->data.file_length;
-  block_write(fs_device, prev_node->sector, &prev_node->data);
-  block_write(fs_device, current_node->sector, &current_node->data);
-
-  return current_node;
+  return current;
 }
 
-// Fill up a single inode.
-bool
-inode_fill(struct inode *current_node, uint32_t *bytes_left, uint32_t length)
+/* Returns the length, in bytes, of INODE's data. */
+off_t
+inode_length(const struct inode *inode)
 {
-  ASSERT(current_node != NULL);
-  ASSERT(bytes_left != NULL);
-  // Calculate the number of sectors this node will contain
-  uint32_t sector_idx = DIV_ROUND_UP(current_node->data.node_length,
-                                     BLOCK_SECTOR_SIZE);
-
-  // Hold disk sector address of the data blocks to be allocated
-  block_sector_t data_addr;
-
-  // Allocate space for the data blocks
-  while ((sector_idx < NODE_CAPACITY) && (*bytes_left > 0))
-  {
-    if (!free_map_allocate(1, &data_addr))
-    {
-      // Free all allocated pages ??
-      return false;
-    }
-    else
-    {
-      // Successfully allocated disk space for DATA node
-      // Write block of all zero to data sector
-      block_write(fs_device, data_addr, &zeros);
-
-      // Set the metadata for the DATA sector to existing
-      current_node->data.blockptrs[sector_idx] = ptr_create(data_addr);
-      ptr_set_exist(&current_node->data.blockptrs[sector_idx]);
-
-      // Calculate the difference between the new size and the old size
-      uint32_t diff = (sector_idx + 1) * BLOCK_SECTOR_SIZE - current_node->data.node_length;
-
-      // Update used capacity of the current node
-      if (*bytes_left < diff)
-      {
-        current_node->data.node_length += *bytes_left;
-        *bytes_left = 0;
-      }
-      else
-      {
-        current_node->data.node_length += diff;
-        *bytes_left -= diff;
-      }
-
-      // Update loop parameters
-      sector_idx++;
-    }
-  }
-
-  current_node->data.file_length = length;
-  block_write(fs_device, current_node->sector, &current_node->data);
-  return true;
+  return inode->data.file_length;
 }
@@ -15,27 +15,46 @@ struct bitmap;
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
-/* Number of sectors per inode */
-#define NODE_CAPACITY 244
+/* Version of the on-disk inode format. Version 1 had 16-bit pointers
+   holding a 14-bit sector number and the exist and isdir flags, and
+   version 2 had no parent pointer. */
+#define INODE_VERSION 3
 
-/* Number of bytes stored per inode (= NODE_CAPACITY * BLOCK_SECTOR_SIZE) */
-#define BYTE_CAPACITY (BLOCK_SECTOR_SIZE * NODE_CAPACITY)
+/* Inode flags */
+#define INODE_DIR 0x1                   // Inode is a directory
+#define INODE_DIR_HASHED 0x2            // Directory entries are hashed
 
-typedef uint16_t inode_ptr;
+/* A sector pointer, 0 if there is no sector. Sector 0 holds the free map
+   inode, so it is never pointed to. */
+typedef uint32_t inode_ptr;
+
+/* Number of data sectors pointed to directly by an inode */
+#define DIRECT_CNT 120
+
+/* Number of levels of indirect blocks */
+#define INDIRECT_LEVELS 3
+
+/* Number of pointers held by an indirect block */
+#define PTRS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof(inode_ptr))
 
 //======[ Struct Definitions ]===============================================
 
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+   Data sector N of the file is DIRECT[N] for the first DIRECT_CNT
+   sectors. The following sectors are found through INDIRECT[0], which
+   points to a block of data pointers, then through the two levels of
+   blocks below INDIRECT[1], and then the three levels below INDIRECT[2].
+   This addresses a bit over 1 GB per file. */
 struct inode_disk
 {
   off_t file_length;                    // File length in bytes
-  off_t prev_length;                    // Combined length of previous inodes
-  off_t node_length;                    // Number of bytes used in this node
-  inode_ptr self;                       // Pointer to myself, for reference
   uint32_t magic;                       // Magic number
-  inode_ptr doubleptr;                  // Pointer to next indirect inode
-  inode_ptr blockptrs[NODE_CAPACITY];   // Index of data pointers
+  uint32_t version;                     // Format version
+  uint32_t flags;                       // INODE_* flags
+  inode_ptr parent;                     // Parent of a directory, for ".."
+  inode_ptr direct[DIRECT_CNT];         // Data pointers
+  inode_ptr indirect[INDIRECT_LEVELS];  // Indirect block pointers
 };
 
 /* In-memory inode. */
@@ -47,10 +66,10 @@ struct inode
   bool removed;                       // True if deleted, false otherwise
   int deny_write_cnt;                 // 0: writes ok, >0: deny writes.
   struct semaphore extend_sema;
+  struct lock dir_lock;               // Orders changes to directory entries
   bool is_dir;                        // 0 is file, 1 is directory
 
   struct inode_disk data;             // Inode content.
-  struct inode* next;                 // The subsequent inode struct pointer
 };
 
 //======[ Forward Declarations ]=============================================
@@ -66,9 +85,11 @@ void inode_close(struct inode *);
 void inode_remove(struct inode *);
 off_t inode_read_at(struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at(struct inode *, const void *, off_t size, off_t offset);
+void inode_read_ahead(struct inode *, off_t size, off_t offset);
 void inode_deny_write(struct inode *);
 void inode_allow_write(struct inode *);
 off_t inode_length(const struct inode *);
+bool inode_is_current(block_sector_t);
 
 //==========[ NEW: inode_ptr functions ]=====================================
 
@@ -76,29 +97,17 @@ off_t inode_length(const struct inode *);
 inode_ptr ptr_create(block_sector_t sector);
 // Get disk sector address from inode ptr
 block_sector_t ptr_get_address(const inode_ptr *ptr);
-// Register the pointer as having data on disk
-void ptr_set_exist(inode_ptr *ptr);
-// Return true if the meta data says the pointer exists on disk
+// Return true if the pointer points to a sector
 bool ptr_exists(const inode_ptr *ptr);
-// Set the pointer as being a directory file
-void ptr_set_isdir(inode_ptr *ptr);
-// Return true if the meta data says the pointer is a directory file
-bool ptr_isdir(const inode_ptr *ptr);
 
 //==========[ NEW: inode functions ]=========================================
 
-// Allocate a single new inode, along with its data. If ON_DISK is true, also
-// allocate space on disk for the inode.
-// Return the struct inode pointer if successful, NULL otherwise
-struct inode *allocate_inode(bool on_disk);
-// Return the disk address of the next inode (if it exists, otherwise -1)
-block_sector_t get_next_addr(struct inode *node);
-
-bool inode_fill(struct inode *current_node, uint32_t *bytes_left, uint32_t length);
-struct inode* inode_extend_link(struct inode *prev_node, uint32_t bytes_left, uint32_t length);
-
 bool inode_is_dir(struct inode* ip);
 bool inode_is_file(struct inode* ip);
 void inode_mark_dir(struct inode *ip);
+bool inode_is_hashed(struct inode *ip);
+void inode_mark_hashed(struct inode *ip);
+block_sector_t inode_get_parent(const struct inode *ip);
+void inode_set_parent(struct inode *ip, block_sector_t parent);
 
 #endif /* filesys/inode.h */
@@ -41,26 +41,6 @@ path_isvalid(const char *path)
   return success;
 }
 
-/** Return a normalized absolutized version of the path name PATH. */
-char *path_abspath(const char *path)
-{
-  char *join = path_join2(path_cwd(), path);
-  if (join == NULL) {
-    return NULL;
-  }
-
-  char *norm = path_normpath(join);
-  if (norm == NULL) {
-    return NULL;
-  }
-  return norm;
-}
-
-char *path_cwd(void)
-{
-  return &thread_current()->pwd[0];
-}
-
 /**
  * Return a normalized version of the path name PATH.
  * It collapses redundant separators and up-level references.
@@ -367,63 +347,38 @@ path_join2(const char *path1, const char *path2)
 }
 
 /**
- * Return TRUE if PATH refers to an existing path.
+ * Look up PATH, starting at the root or the current directory, and store
+ * its directory entry in ENTRY. "." and ".." are directories without a
+ * meaningful entry. Return TRUE if PATH exists.
  */
-bool path_exists(const char *path)
+static bool path_lookup(const char *path, struct dir_entry *entry)
 {
-  if (path == NULL) {
-    return false;
-  }
-  bool success = path_isvalid(path);     // Path must first be valid
-  struct dir *dir = NULL;
-  struct dir_entry entry;
-
-  char *abspath = NULL, *sentry = NULL, *token = NULL, *save_ptr = NULL;
+  char name[NAME_MAX + 1];
+  struct dir *dir = dir_open_parent(path, name);
+  bool success = (dir != NULL);
 
   if (success) {
-    // So far so good: walk the tree from root to said directory
-    abspath = path_abspath(path);
-    if (abspath == NULL) {
-      // Can't tell: better say now
-      return false;
+    if (path_isdot(name) || path_isdotdot(name)) {
+      entry->is_dir = true;
     }
-    dir = dir_open_root();
-
-    sentry = strtok_r(abspath, "/", &save_ptr);
-    token = sentry;
-    sentry = strtok_r(NULL, "/", &save_ptr);
-
-    enum intr_level old_level = intr_disable();
-    while (token != NULL && success) {
-      intr_enable();
-      if (sentry == NULL) {
-        // Token represents the last token in path: can be file or directory
-        success = lookup(dir, token, &entry, &dir->pos);
-        dir_close(dir);
-      }
-      else {
-        // Token is not the last token in path: must be a directory
-        success = lookup(dir, token, &entry, &dir->pos) && entry.is_dir;
-        dir_close(dir);
-
-        if (success) {
-          dir = dir_open(inode_open(entry.inode_sector));
-          success = (dir != NULL);
-        }
-      }
-      intr_disable();
-
-      token = sentry;
-      sentry = strtok_r(NULL, "/", &save_ptr);
+    else {
+      success = lookup(dir, name, entry, NULL);
     }
-
-    if (abspath) free(abspath);
-    intr_set_level(old_level);
+    dir_close(dir);
   }
 
   return success;
 }
 
+/**
+ * Return TRUE if PATH refers to an existing path.
+ */
+bool path_exists(const char *path)
+{
+  struct dir_entry entry;
+  return path_lookup(path, &entry);
+}
+
 /**
  * Return TRUE if PATH is an absolute path name, i.e. it begins with a slash
  */
@@ -445,67 +400,8 @@ bool path_isabs(const char *path)
  */
 bool path_isfile(const char *path)
 {
-  if (path == NULL) {
-    return false;
-  }
-  bool success = path_isvalid(path);     // Path must first be valid
-  struct dir *dir = NULL;
   struct dir_entry entry;
-
-  char *abspath = NULL, *sentry = NULL, *token = NULL, *save_ptr = NULL;
-
-  if (success) {
-    // So far so good: walk the tree from root to said directory
-    abspath = path_abspath(path);
-    if (abspath == NULL) {
-      // Can't tell: better say no
-      return false;
-    }
-    dir = dir_open_root();
-
-    enum intr_level old_level = intr_disable();
-
-    sentry = strtok_r(abspath, "/", &save_ptr);
-    token = sentry;
-    sentry = strtok_r(NULL, "/", &save_ptr);
-
-    if (token == NULL) {
-      if (abspath) free(abspath);
-      intr_set_level(old_level);
-      success = false;
-      return success;
-    }
-
-    while (token != NULL && success) {
-      intr_enable();
-
-      if (sentry == NULL) {
-        // Token represents the last token in path: must be a file
-        success = lookup(dir, token, &entry, &dir->pos) && !entry.is_dir;
-        dir_close(dir);
-      }
-      else {
-        // Token is not the last token in path: must be a directory
-        success = lookup(dir, token, &entry, &dir->pos) && entry.is_dir;
-        dir_close(dir);
-
-        if (success) {
-          dir = dir_open(inode_open(entry.inode_sector));
-          success = (dir != NULL);
-        }
-      }
-
-      intr_disable();
-
-      token = sentry;
-      sentry = strtok_r(NULL, "/", &save_ptr);
-    }
-
-    if (abspath) free(abspath);
-    intr_set_level(old_level);
-  }
-
-  return success;
+  return path_lookup(path, &entry) && !entry.is_dir;
 }
 
 /**
@@ -513,65 +409,8 @@ bool path_isfile(const char *path)
  */
 bool path_isdir(const char *path)
 {
-  if (path == NULL) {
-    return false;
-  }
-  bool success = path_isvalid(path);     // Path must first be valid
-  struct dir *dir = NULL;
   struct dir_entry entry;
-
-  char *abspath = NULL, *sentry = NULL, *token = NULL, *save_ptr = NULL;
-
-  if (success) {
-    // So far so good: walk the tree from root to said directory
-    abspath = path_abspath(path);
-    if (abspath == NULL) {
-      // Can't tell: better say no
-      return false;
-    }
-    dir = dir_open_root();
-    ASSERT(dir != NULL);
-
-    enum intr_level old_level = intr_disable();
-    sentry = strtok_r(abspath, "/", &save_ptr);
-    token = sentry;
-    sentry = strtok_r(NULL, "/", &save_ptr);
-
-    if (token == NULL) {
-      if (abspath) free(abspath);
-      intr_set_level(old_level);
-      success = true;
-      return success;
-    }
-
-    while (success && token != NULL) {
-      intr_enable();
-      if (sentry == NULL) {
-        // Token represents the last token in path: can be file or directory
-        success = lookup(dir, token, &entry, &dir->pos) && entry.is_dir;
-        dir_close(dir);
-      }
-      else {
-        // Token is not the last token in path: must be a directory
-        success = lookup(dir, token, &entry, &dir->pos) && entry.is_dir;
-        dir_close(dir);
-
-        if (success) {
-          dir = dir_open(inode_open(entry.inode_sector));
-          success = (dir != NULL);
-        }
-      }
-      intr_disable();
-
-      token = sentry;
-      sentry = strtok_r(NULL, "/", &save_ptr);
-    }
-
-    if (abspath) free(abspath);
-    intr_set_level(old_level);
-  }
-
-  return success;
+  return path_lookup(path, &entry) && entry.is_dir;
 }
 
 /** Return TRUE if PATH is the root directory (/) */
@@ -7,15 +7,9 @@
  * Provide path-related functionalities.
  */
 
-/** Return the current working directory. */
-char* path_cwd(void);
-
 /** Return TRUE if PATH is valid */
 bool path_isvalid(const char *path);
 
-/** Return a normalized absolutized version of the path name PATH. */
-char* path_abspath(const char* path);
-
 /**
  * Return a normalized version of the path name PATH.
  * It collapses redundant separators and up-level references.
@@ -0,0 +1,155 @@
+#include <lz.h>
+#include <string.h>
+
+/* Limits of the token format.  See lz.h. */
+#define MAX_LITERAL 32                  /* Longest literal run. */
+#define MAX_OFFSET (1 << 13)            /* Farthest back reference. */
+#define MAX_MATCH (2 + 7 + 255)         /* Longest back reference. */
+
+/* Returns the hash table slot for the three bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t v = ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the SRC_SIZE bytes at SRC into the DST_SIZE byte
+   buffer DST, using TABLE as scratch space.  Returns the size of
+   the compressed data, or 0 if it would not fit in DST_SIZE
+   bytes, e.g. because the input does not compress. */
+size_t
+lz_compress (const void *src, size_t src_size, void *dst, size_t dst_size,
+             uint16_t table[LZ_HASH_SIZE])
+{
+  const uint8_t *in = src;
+  uint8_t *out = dst;
+  size_t ip = 0;                /* Next input byte. */
+  size_t op = 1;                /* Next output byte, after a literal
+                                   run header. */
+  size_t lit = 0;               /* Length of the open literal run. */
+
+  if (src_size == 0 || src_size > LZ_MAX_INPUT)
+    return 0;
+
+  /* Positions are stored plus one, so that 0 means empty. */
+  memset (table, 0, LZ_HASH_SIZE * sizeof *table);
+
+  while (ip < src_size)
+    {
+      if (ip + 2 < src_size)
+        {
+          unsigned h = hash3 (in + ip);
+          size_t ref = table[h];
+          table[h] = ip + 1;
+
+          if (ref != 0 && ip - ref < MAX_OFFSET
+              && in[ref - 1] == in[ip] && in[ref] == in[ip + 1]
+              && in[ref + 1] == in[ip + 2])
+            {
+              size_t off = ip - ref;
+              size_t len = 3;
+              size_t max = src_size - ip;
+
+              ref--;
+              if (max > MAX_MATCH)
+                max = MAX_MATCH;
+              while (len < max && in[ref + len] == in[ip + len])
+                len++;
+
+              /* Close the literal run, or take back its header. */
+              if (lit > 0)
+                out[op - lit - 1] = lit - 1;
+              else
+                op--;
+
+              if (op + 3 > dst_size)
+                return 0;
+              if (len - 2 < 7)
+                out[op++] = (off >> 8) + ((len - 2) << 5);
+              else
+                {
+                  out[op++] = (off >> 8) + (7 << 5);
+                  out[op++] = len - 2 - 7;
+                }
+              out[op++] = off & 0xff;
+
+              /* Open a new literal run. */
+              ip += len;
+              lit = 0;
+              op++;
+              continue;
+            }
+        }
+
+      /* No match: copy one literal byte. */
+      if (op >= dst_size)
+        return 0;
+      out[op++] = in[ip++];
+      if (++lit == MAX_LITERAL)
+        {
+          out[op - lit - 1] = MAX_LITERAL - 1;
+          lit = 0;
+          op++;
+        }
+    }
+
+  if (lit > 0)
+    out[op - lit - 1] = lit - 1;
+  else
+    op--;
+  return op;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into the DST_SIZE byte buffer DST.  Returns the
+   size of the decompressed data, or 0 if SRC is corrupt or does
+   not fit in DST. */
+size_t
+lz_decompress (const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+  const uint8_t *in = src;
+  uint8_t *out = dst;
+  size_t ip = 0;
+  size_t op = 0;
+
+  while (ip < src_size)
+    {
+      unsigned c = in[ip++];
+
+      if (c < MAX_LITERAL)
+        {
+          /* Literal run. */
+          size_t len = c + 1;
+          if (ip + len > src_size || op + len > dst_size)
+            return 0;
+          memcpy (out + op, in + ip, len);
+          ip += len;
+          op += len;
+        }
+      else
+        {
+          /* Back reference, which may overlap the bytes it
+             produces: copy one byte at a time. */
+          size_t len = c >> 5;
+          size_t off;
+
+          if (len == 7)
+            {
+              if (ip >= src_size)
+                return 0;
+              len += in[ip++];
+            }
+          if (ip >= src_size)
+            return 0;
+          off = ((c & 0x1f) << 8) + in[ip++] + 1;
+          len += 2;
+
+          if (off > op || op + len > dst_size)
+            return 0;
+          for (; len > 0; len--, op++)
+            out[op] = out[op - off];
+        }
+    }
+  return op;
+}
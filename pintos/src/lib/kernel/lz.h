@@ -0,0 +1,34 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* A small, fast LZ77-family compressor, in the spirit of LZF.
+   It trades compression ratio for speed: a single hash probe per
+   input position, no entropy coding.
+
+   The compressed stream is a sequence of tokens, each starting
+   with a control byte C:
+
+     C < 32:   literal run, C + 1 bytes copied as is follow.
+     C >= 32:  back reference.  LEN = C >> 5 is the match length
+               minus 2; if it is 7, the next byte is added to it.
+               The distance minus 1 is (C & 0x1f) << 8 followed
+               by one more byte. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of entries in the hash table passed to lz_compress(). */
+#define LZ_HASH_BITS 10
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+
+/* Largest input lz_compress() accepts, since the hash table
+   stores positions in 16 bits. */
+#define LZ_MAX_INPUT 65535
+
+size_t lz_compress (const void *src, size_t src_size,
+                    void *dst, size_t dst_size,
+                    uint16_t table[LZ_HASH_SIZE]);
+size_t lz_decompress (const void *src, size_t src_size,
+                      void *dst, size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
@@ -0,0 +1,63 @@
+/* Forks, then checks that memory written by the child after the
+   fork is not seen by the parent, and memory written by the
+   parent is not seen by the child. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+/* Returns true if every byte of BUF is C. */
+static bool
+buf_is (char c)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  volatile char local = 'p';
+  pid_t child;
+  int handle;
+
+  memset (buf, 'p', SIZE);
+
+  /* The child's writes stay in the child. */
+  child = fork ();
+  if (child == 0)
+    {
+      memset (buf, 'c', SIZE);
+      local = 'c';
+      exit (buf_is ('c') && local == 'c' ? 0x42 : 1);
+    }
+  CHECK (child != -1, "fork");
+  CHECK (wait (child) == 0x42, "wait for child");
+  CHECK (buf_is ('p') && local == 'p', "parent memory unchanged");
+
+  /* The parent's writes stay in the parent.  The child looks only
+     once "written" exists, after the parent is done writing. */
+  child = fork ();
+  if (child == 0)
+    {
+      while ((handle = open ("written")) == -1)
+        continue;
+      close (handle);
+      exit (buf_is ('p') && local == 'p' ? 0x42 : 1);
+    }
+  CHECK (child != -1, "fork");
+  memset (buf, 'q', SIZE);
+  local = 'q';
+  CHECK (create ("written", 0), "create \"written\"");
+  CHECK (wait (child) == 0x42, "wait for child");
+  CHECK (buf_is ('q') && local == 'q', "parent memory unchanged");
+}
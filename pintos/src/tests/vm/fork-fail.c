@@ -0,0 +1,75 @@
+/* Each process forks a child that does the same, holding 1 MB of
+   swapped out memory each, until swap runs out and fork fails.
+   The failed fork must return -1 and leave the process that
+   called it intact, and the chain must unwind cleanly. */
+
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+
+/* Swap space holds only a few copies of BUF, so fork must fail
+   long before this depth. */
+#define MAX_DEPTH 32
+
+static char buf[SIZE];
+
+/* Decrypts BUF, and returns true if it is back to zeros. */
+static bool
+buf_is_intact (void)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      return false;
+  return true;
+}
+
+/* Forks a child that calls this function at DEPTH + 1, and
+   waits for it.  Returns the number of processes forked below
+   this one, or -1 if fork never failed or a process found its
+   memory damaged or was killed. */
+static int
+fork_chain (int depth)
+{
+  pid_t child;
+  int forked;
+
+  if (depth == MAX_DEPTH)
+    return -1;
+
+  child = fork ();
+  if (child == -1)
+    return buf_is_intact () ? 0 : -1;
+  if (child == 0)
+    exit (fork_chain (depth + 1));
+
+  forked = wait (child);
+  return forked < 0 ? -1 : forked + 1;
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+
+  /* With at most 32 pages resident, most of BUF goes to swap. */
+  CHECK (setrss (16, 32), "setrss 16 32");
+  msg ("encrypt");
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+
+  msg ("fork until out of swap");
+  if (fork_chain (0) < 0)
+    fail ("fork did not fail cleanly");
+
+  msg ("check");
+  if (!buf_is_intact ())
+    fail ("parent memory damaged");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-fail) begin
+(fork-fail) setrss 16 32
+(fork-fail) encrypt
+(fork-fail) fork until out of swap
+(fork-fail) check
+(fork-fail) end
+EOF
+pass;
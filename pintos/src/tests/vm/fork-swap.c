@@ -0,0 +1,69 @@
+/* Forks a process with most of its memory swapped out and a file
+   mapped.  The child must see the swapped out data, and must not
+   inherit the mapping: touching it kills the child.  Afterward
+   the parent's memory and mapping must be intact. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (256 * 1024)
+
+static char buf[SIZE];
+
+/* Decrypts BUF, and returns true if it is back to zeros. */
+static bool
+buf_is_intact (void)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  struct arc4 arc4;
+  int handle;
+  mapid_t map;
+  pid_t child;
+
+  /* With at most 32 pages resident, most of BUF goes to swap. */
+  CHECK (setrss (16, 32), "setrss 16 32");
+  msg ("encrypt");
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+
+  child = fork ();
+  if (child == 0)
+    {
+      if (!buf_is_intact ())
+        exit (1);
+      (void) *(volatile char *) actual;
+      exit (2);
+    }
+  CHECK (child != -1, "fork");
+  CHECK (wait (child) == -1, "wait for child (must have been killed)");
+
+  msg ("check");
+  if (!buf_is_intact ())
+    fail ("parent memory damaged");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+
+  munmap (map);
+  close (handle);
+}
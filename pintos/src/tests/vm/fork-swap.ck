@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-swap) begin
+(fork-swap) setrss 16 32
+(fork-swap) encrypt
+(fork-swap) open "sample.txt"
+(fork-swap) mmap "sample.txt"
+(fork-swap) fork
+(fork-swap) wait for child (must have been killed)
+(fork-swap) check
+(fork-swap) end
+EOF
+pass;
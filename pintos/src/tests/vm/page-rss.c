@@ -0,0 +1,40 @@
+/* Limits the resident set with setrss, then encrypts and decrypts
+   1 MB of memory, far more than the hard limit allows to be
+   resident, and verifies that it is back to zeros.  Finally runs
+   a child, which inherits the limits, doing the same. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  pid_t child;
+  size_t i;
+
+  CHECK (!setrss (64, 32), "setrss with soft limit above hard fails");
+  CHECK (setrss (16, 32), "setrss 16 32");
+
+  /* Encrypt zeros, then decrypt back to zeros. */
+  msg ("encrypt and decrypt");
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+  arc4_init (&arc4, "foobar", 6);
+  arc4_crypt (&arc4, buf, SIZE);
+
+  msg ("check");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+
+  CHECK ((child = exec ("child-linear")) != -1, "exec \"child-linear\"");
+  CHECK (wait (child) == 0x42, "wait for child");
+}
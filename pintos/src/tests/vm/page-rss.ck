@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-rss) begin
+(page-rss) setrss with soft limit above hard fails
+(page-rss) setrss 16 32
+(page-rss) encrypt and decrypt
+(page-rss) check
+(page-rss) exec "child-linear"
+(page-rss) wait for child
+(page-rss) end
+EOF
+pass;
@@ -62,6 +62,7 @@ static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
 static void paging_init (void);
+static bool cpu_has_pse (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -169,6 +170,17 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
+  bool pse = cpu_has_pse ();
+  const size_t super_pages = PTSPAN / PGSIZE;
+
+  /* Superpages need CR4_PSE before the page directory is loaded. */
+  if (pse)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -179,6 +191,19 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      /* Map whole aligned 4 MB runs with a single superpage, as
+         long as they hold no kernel text, which must stay
+         read-only, and no user pool pages, whose dirty and
+         accessed bits the VM tracks page by page. */
+      if (pse && pte_idx == 0 && page + super_pages <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text)
+          && !palloc_overlaps_user (vaddr, super_pages))
+        {
+          pd[pde_idx] = pde_create_super (vaddr, true);
+          page += super_pages - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -196,6 +221,18 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* Returns true if the CPU supports 4 MB pages (PSE), as
+   reported by CPUID.  See [IA32-v2a] "CPUID--CPU
+   Identification". */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & (1 << 3)) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -259,6 +296,27 @@ parse_options (char **argv)
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-evict"))
+        {
+          if (value != NULL && !strcmp (value, "clock"))
+            frame_evict_policy = FRAME_EVICT_CLOCK;
+          else if (value != NULL && !strcmp (value, "aging"))
+            frame_evict_policy = FRAME_EVICT_AGING;
+          else
+            PANIC ("unknown eviction policy `%s' (use -h for help)", value);
+        }
+      else if (!strcmp (name, "-stack"))
+        stack_page_limit = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        zswap_page_limit = atoi (value);
+      else if (!strcmp (name, "-rss-soft"))
+        rss_soft_limit = atoi (value);
+      else if (!strcmp (name, "-rss-hard"))
+        rss_hard_limit = atoi (value);
+      else if (!strcmp (name, "-vmstat"))
+        vmstat_at_exit = true;
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
@@ -384,6 +442,14 @@ usage (void)
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
+#endif
+#ifdef VM
+          "  -evict=POLICY      Evict frames by POLICY (clock or aging).\n"
+          "  -stack=COUNT       Limit user stacks to COUNT pages.\n"
+          "  -zswap=COUNT       Compress swapped pages into COUNT pages.\n"
+          "  -rss-soft=COUNT    By default, evict first above COUNT frames.\n"
+          "  -rss-hard=COUNT    By default, limit processes to COUNT frames.\n"
+          "  -vmstat            Print VM statistics of processes at exit.\n"
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
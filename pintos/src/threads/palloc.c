@@ -61,6 +61,27 @@ palloc_init (size_t user_page_limit)
              user_pages, "user pool");
 }
 
+/* Returns true if any of the PAGE_CNT pages starting at kernel
+   virtual address PAGES belongs to the user pool. */
+bool
+palloc_overlaps_user (const void *pages, size_t page_cnt)
+{
+  size_t page_no = pg_no (pages);
+  size_t start_page = pg_no (user_pool.base);
+  size_t end_page = start_page + bitmap_size (user_pool.used_map);
+
+  return page_no < end_page && page_no + page_cnt > start_page;
+}
+
+/* Returns the first page of the user pool and stores the number
+   of pages in the pool in *PAGE_CNT. */
+void *
+palloc_user_pool (size_t *page_cnt)
+{
+  *page_cnt = bitmap_size (user_pool.used_map);
+  return user_pool.base;
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -66,6 +66,10 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB superpage (PDEs only). */
+
+/* Control register 4 bit that enables PTE_PS in PDEs. */
+#define CR4_PSE 0x10
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -80,6 +84,22 @@ static inline uint32_t *pde_get_pt (uint32_t pde) {
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB superpage starting at PAGE,
+   which must be aligned on a 4 MB boundary.
+   If WRITABLE is true then it will be writable as well.
+   The superpage will be usable only by ring 0 code (the kernel).
+   Requires CR4_PSE to be set. */
+static inline uint32_t pde_create_super (void *page, bool writable) {
+  ASSERT (((uintptr_t) page & (PTSPAN - 1)) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
+/* Returns true if page directory entry PDE maps a superpage
+   rather than pointing to a page table. */
+static inline bool pde_is_super (uint32_t pde) {
+  return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
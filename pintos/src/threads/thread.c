@@ -24,6 +24,7 @@
 
 #ifdef VM
   #include "vm/swap.h"
+  #include "vm/frame.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -203,6 +204,11 @@ thread_tick (void)
     }
   }
 
+#ifdef VM
+  /* Let the frame table schedule its aging sweep. */
+  frame_tick ();
+#endif
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
@@ -302,6 +308,8 @@ thread_create (const char *name, int priority,
   list_push_back(&thread_current()->child_list, &es->child_elem);
 #ifdef VM
   page_table_init(&t->pages);
+  list_init(&t->mmaps);
+  t->nextMapid = 0;
 #endif
 
   /* Re-enable interrupt */
@@ -690,9 +698,9 @@ init_thread (struct thread *t, const char *name, int priority)
   /* When done, add thread to all-thread list */
   list_push_back(&all_list, &(t->allelem));
   intr_set_level(old_level);
-  
-  /* Initialize present working directory as the root */
-  strlcpy(t->pwd, "/", 2);
+
+  /* Start in the root directory */
+  t->cwd = NULL;
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -158,15 +158,17 @@ struct thread
   struct list child_list;         /* List of all child threads */
 
   struct page_table pages;
+  struct list mmaps;              /* List of memory mapped files */
+  int nextMapid;                  /* The next mapping ID, increment */
 
   int nextFD;                     /* The next file, increment */
   
-  /* Keep track of current directory */
-  char pwd[PATH_MAX];
+  struct dir *cwd;                /* Current directory, NULL for the root. */
 
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
   uint32_t *pagedir;              /* Page directory. */
+  void *user_esp;                 /* User esp at system call entry. */
 #endif
 
   /* Owned by thread.c. */
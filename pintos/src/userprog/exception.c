@@ -10,12 +10,12 @@
   #include "vm/frame.h"
   #include "vm/page.h"
   #include "vm/swap.h"
+  #include "vm/vmstat.h"
 #endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
-static struct semaphore extend_sema;    // Protect stack extension
 static struct semaphore fault_sema;     // Protect page fault handler
 
 static void kill (struct intr_frame *);
@@ -73,7 +73,6 @@ exception_init (void)
      fault address is stored in CR2 and needs to be preserved. */
   intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
 
-  sema_init(&extend_sema, 1);
   sema_init(&fault_sema, 1);
 }
 
@@ -82,6 +81,9 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  vmstat_print_global ();
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -161,6 +163,9 @@ page_fault (struct intr_frame *f)
   page_fault_cnt++;
 
 #ifdef VM
+  struct vmstat_fault vf;
+  vmstat_fault_begin(&vf);
+
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
@@ -168,75 +173,72 @@ page_fault (struct intr_frame *f)
 
   if (not_present && write && !user) {
     // System write: try to allocate more space if page not owned
-    if (!load_page(fault_addr)) {
+    if (!load_page(fault_addr, true)) {
       extend_stack(f, fault_addr);
     }
   }
   else if (not_present && write && user) {
     // User write: try to allocate more space if page not owned
-    if (!load_page(fault_addr)) {
+    if (!load_page(fault_addr, true)) {
       extend_stack(f, fault_addr);
     }
   }
   else if (not_present && !write && !user) {
     // System read: kill if page not owned
-    if (!load_page(fault_addr)) {
+    if (!load_page(fault_addr, false)) {
       kill_process(f);
     }
   }
   else if (not_present && !write && user) {
     // User read: kill if page not owned
-    if (!load_page(fault_addr)) {
+    if (!load_page(fault_addr, false)) {
       kill_process(f);
     }
   }
   else if (!not_present && !write && user) {
     // User read access violation: kill if page not owned
-    if (!load_page(fault_addr)) {
+    if (!load_page(fault_addr, false)) {
       kill_process(f);
     }
   }
-  else if (!not_present && write && user) {
-    // User write access violation: kill unconditionally
-    kill_process(f);
+  else if (!not_present && write) {
+    // Write access violation: kill unless the page is copy-on-write
+    if (!page_break_cow(fault_addr)) {
+      kill_process(f);
+    }
   }
   else {
     // Illegal access: kill process
     kill_process(f);
   }
+
+  vmstat_fault_end(&vf);
 #else
   kill_process(f);
 #endif
 }
 
 #ifdef VM
-/// Extend the stack from the faulting addres up to the base pointer of the faulting thread
-/// Called by page_fault
+/// Extend the stack down to the faulting address, or kill the process if
+/// the access is not a stack access. A user push may fault up to 32 bytes
+/// below the stack pointer (PUSHA); anything lower is a wild access. For a
+/// fault in the kernel, on a user buffer passed to a system call, the
+/// stack pointer is the one saved at system call entry; before the first
+/// system call, such a fault comes from load() pushing the arguments.
+/// Growth is tracked in the faulting process' own stack region, but the
+/// pages are loaded through the global paging and eviction locks like any
+/// other. Called by page_fault
 static void
 extend_stack (struct intr_frame *f, void *fault_addr) {
   ASSERT(f != NULL);
-  ASSERT(f->frame_pointer != NULL);
-  uint32_t bottom = (((uint32_t) fault_addr) / PGSIZE) * PGSIZE;
-  uint32_t top = (((uint32_t) f->frame_pointer) / PGSIZE) * PGSIZE;
-  uint32_t addr;
-  bool success = false;
-
-  // Only one process should extend the stack at a time
-  sema_down(&extend_sema);
-
-  for (addr = bottom; addr < top ; addr += PGSIZE) {
-    // Obtain the page associated with the faulting address
-    struct page_entry *entry = allocate_page((void*) addr);
+  bool user = (f->error_code & PF_U) != 0;
+  uint8_t *esp = user ? f->esp : thread_current()->user_esp;
 
-    if (!load_page_entry(entry)) {
-      break;
-    }
-    success = true;
+  if (esp != NULL && (uint8_t *) fault_addr < esp - 32) {
+    kill_process(f);
   }
-  sema_up(&extend_sema);
-
-  // If the extension fails, this is an access violation: kill process
-  if (!success) {
+  else if (!page_grow_stack(fault_addr)) {
+    // If the extension fails, this is an access violation: kill process
     kill_process(f);
   }
 }
@@ -8,6 +8,8 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+static bool demote_superpage (uint32_t *pd, uint32_t *pde);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -44,6 +46,12 @@ pagedir_destroy (uint32_t *pd)
             palloc_free_page (pte_get_page (*pte));
         palloc_free_page (pt);
       }
+
+  /* Kernel superpages demoted in PD got page tables of their own. */
+  for (; pde < pd + PGSIZE / sizeof *pde; pde++)
+    if (*pde != init_page_dir[pde - pd] && (*pde & PTE_P)
+        && !pde_is_super (*pde))
+      palloc_free_page (pde_get_pt (*pde));
   palloc_free_page (pd);
 }
 
@@ -79,6 +87,14 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
       else
         return NULL;
     }
+  else if (pde_is_super (*pde))
+    {
+      /* VADDR lies in a superpage: split it into small pages so
+         that the page can be mapped, protected or queried on its
+         own. */
+      if (!demote_superpage (pd, pde))
+        return NULL;
+    }
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -152,7 +168,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +196,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,7 +225,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -226,8 +242,11 @@ pagedir_activate (uint32_t *pd)
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-     Address of the Page Directory". */
-  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+     Address of the Page Directory".
+     Loading CR3 also flushes the TLB, so skip it when PD is
+     already active. */
+  if (active_pd () != pd)
+    asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
 /* Returns the currently active page directory. */
@@ -256,8 +275,46 @@ invalidate_pagedir (uint32_t *pd)
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
+      /* Reloading CR3 clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
     } 
 }
+
+/* Some page table changes can cause the CPU's translation
+   lookaside buffer (TLB) to become out-of-sync with the page
+   table.  When this happens for the single page VPAGE of PD,
+   it is enough to drop that page's TLB entry with INVLPG rather
+   than the whole TLB.  Pages of an inactive PD cannot be cached.
+   See [IA32-v2a] "INVLPG--Invalidate TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vpage)
+{
+  if (active_pd () == pd)
+    asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
+}
+
+/* Replaces the superpage mapped by PDE in PD by a page table
+   that maps the same 4 MB with small pages of the same
+   permissions.  Returns true if successful, false if no page
+   table could be allocated. */
+static bool
+demote_superpage (uint32_t *pd, uint32_t *pde)
+{
+  uint32_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+  uint32_t paddr = *pde & ~(PTSPAN - 1);
+  uint32_t *pt;
+  size_t i;
+
+  pt = palloc_get_page (0);
+  if (pt == NULL)
+    return false;
+
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = (paddr + i * PGSIZE) | flags;
+  *pde = vtop (pt) | PTE_P | PTE_W | (flags & PTE_U);
+
+  /* The TLB may still hold the superpage. */
+  invalidate_pagedir (pd);
+  return true;
+}
@@ -25,11 +25,34 @@
   #include "vm/page.h"
   #include "vm/frame.h"
   #include "vm/swap.h"
+  #include "vm/mmap.h"
 #endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/* Arguments passed by process_execute() to the new process, at
+   the start of a page that holds the command line after them. */
+struct exec_args
+  {
+    struct dir *cwd;            /* Current directory, NULL for the root. */
+    char file_name[];           /* Command line. */
+  };
+
+#ifdef VM
+/* Arguments passed by process_fork() to the new process. */
+struct fork_args
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* User context the child resumes. */
+    struct semaphore done;      /* Upped once the child is set up. */
+    bool success;               /* Whether the child could be set up. */
+  };
+
+static thread_func fork_process NO_RETURN;
+static bool fork_handles (struct thread *parent);
+#endif
+
 #ifndef VM
 /* load() helpers. */
 static bool install_page (void *upage, void *kpage, bool writable);
@@ -111,7 +134,7 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_args *args;
   tid_t tid;
   struct file *file;
   char tmpfilename[16];
@@ -119,12 +142,12 @@ process_execute (const char *file_name)
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL) {
-    printf("process_execute(%s): Cannot get page for fn_copy\n", file_name);
+  args = palloc_get_page (0);
+  if (args == NULL) {
+    printf("process_execute(%s): Cannot get page for args\n", file_name);
     return TID_ERROR;
   }
-  strlcpy (fn_copy, file_name, PGSIZE);
+  strlcpy (args->file_name, file_name, PGSIZE - sizeof *args);
 
   // See if the file exists before trying to execute it
   strlcpy((char*)tmpfilename, file_name, 16);
@@ -139,28 +162,30 @@ process_execute (const char *file_name)
   if (file == NULL) 
     {
       printf ("load: %s: open failed\n", file_name);
+      palloc_free_page (args);
       return TID_ERROR;
     }
 
   file_close(file);
 
+  /* Inherit the current directory. The child takes it over before
+     load(), which may resolve FILE_NAME relative to it. */
+  args->cwd = NULL;
+  if (thread_current()->cwd != NULL)
+    args->cwd = dir_reopen(thread_current()->cwd);
+
   // Create a new thread to execute FILE_NAME.
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (file_name, PRI_DEFAULT, start_process, args);
 
   if (tid == TID_ERROR) {
-    palloc_free_page (fn_copy);
+    dir_close (args->cwd);
+    palloc_free_page (args);
     return TID_ERROR;
   }
 
   // Check if the thread loaded properly
   struct thread *child = thread_by_tid(tid);
   if (child) {
-    /* Initialize present working directory as the root */
-    if (thread_current()->pwd == NULL)
-      strlcpy(child->pwd, "/", 2);
-    else
-      strlcpy(child->pwd, thread_current()->pwd, strlen(thread_current()->pwd) + 1);
-
     // Thread has not yet exited: wait for status of load
     sema_down(&child->exec_sema);
 
@@ -177,12 +202,15 @@ process_execute (const char *file_name)
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *args_)
 {
-  char *file_name = file_name_;
+  struct exec_args *args = args_;
+  char *file_name = args->file_name;
   struct intr_frame if_;
   bool success;
 
+  thread_current ()->cwd = args->cwd;
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
@@ -191,7 +219,7 @@ start_process (void *file_name_)
   success = load (file_name, &if_.eip, &if_.esp);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
+  palloc_free_page (args);
   if (!success) {
     thread_set_exit_status(thread_current()->tid, -1);
     sema_up(&thread_current()->exec_sema);
@@ -210,6 +238,114 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Starts a new process that is a copy of the running one,
+   resuming in user mode from IF_ with 0 as the system call's
+   return value.  Memory is shared copy-on-write, so no page is
+   copied until one of the processes writes to it.  Returns the
+   new process's thread id, or TID_ERROR if it cannot be
+   created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct fork_args args;
+  tid_t tid;
+
+  args.parent = thread_current ();
+  args.if_ = *if_;
+  args.success = false;
+  sema_init (&args.done, 0);
+
+  tid = thread_create (thread_name (), PRI_DEFAULT, fork_process, &args);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* The parent must not run until the child has copied it. */
+  sema_down (&args.done);
+  return args.success ? tid : TID_ERROR;
+}
+
+/* A thread function that makes the new thread a copy of the
+   process that forked it, then starts it running. */
+static void
+fork_process (void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *parent = args->parent;
+  struct thread *t = thread_current ();
+  struct intr_frame if_ = args->if_;
+  bool success = false;
+
+  if (parent->cwd != NULL)
+    t->cwd = dir_reopen (parent->cwd);
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    goto done;
+  process_activate ();
+
+  /* Keep our own handle on the executable, for its pages. */
+  t->ownfile = file_reopen (parent->ownfile);
+  if (t->ownfile == NULL)
+    goto done;
+  file_deny_write (t->ownfile);
+
+  success = fork_handles (parent) && page_table_fork (parent);
+
+ done:
+  /* ARGS lives on the parent's stack: done with it after this. */
+  args->success = success;
+  if (!success)
+    thread_set_exit_status (t->tid, -1);
+  sema_up (&args->done);
+  if (!success)
+    thread_exit ();
+
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Copies the open files and directories of PARENT into the
+   running process, with the same descriptors and positions.
+   Returns false if out of memory. */
+static bool
+fork_handles (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->handles); e != list_end (&parent->handles);
+       e = list_next (e))
+    {
+      struct fileHandle *h = list_entry (e, struct fileHandle, fileElem);
+      struct fileHandle *copy = malloc (sizeof *copy);
+      if (copy == NULL)
+        return false;
+
+      copy->fd = h->fd;
+      copy->file = NULL;
+      copy->dir = NULL;
+      if (h->file != NULL)
+        {
+          copy->file = file_reopen (h->file);
+          if (copy->file != NULL)
+            file_seek (copy->file, file_tell (h->file));
+        }
+      if (h->dir != NULL)
+        copy->dir = dir_reopen (h->dir);
+      if (copy->file == NULL && copy->dir == NULL)
+        {
+          free (copy);
+          return false;
+        }
+      list_push_back (&t->handles, &copy->fileElem);
+    }
+  t->nextFD = parent->nextFD;
+  return true;
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -272,6 +408,10 @@ process_exit (void)
   }
   intr_set_level(old_level);
 
+  // Let go of the current directory, so it can be removed
+  dir_close(cur->cwd);
+  cur->cwd = NULL;
+
   // Clear out our wait list
   old_level = intr_disable();
   while (!list_empty (&cur->wait_list)) {
@@ -282,6 +422,12 @@ process_exit (void)
   intr_set_level(old_level);
 
 #ifdef VM
+  // Write memory mapped files back before their pages are freed
+  mmap_destroy();
+
+  if (vmstat_at_exit)
+    vmstat_print(cur->name, &cur->pages.stats);
+
   // Destroy the supplemental page table, which frees all pages and frames
   // in the process
   page_table_destroy(&cur->pages);
@@ -317,8 +463,11 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  Kernel threads never touch
+     user memory, so they borrow whatever page directory is active
+     instead of flushing the TLB by switching to the kernel one. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -642,6 +791,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
     entry->offset = ofs + page_offset;
     entry->read_bytes = page_read_bytes;
     entry->writable = writable;
+    entry->cow = writable && page_read_bytes > 0;
 
     /* Advance. */
     read_bytes -= page_read_bytes;
@@ -702,8 +852,10 @@ setup_stack (void **esp)
   struct page_entry *entry = allocate_page(((uint8_t *) PHYS_BASE) - PGSIZE);
   success = load_page_entry(entry);
 
-  if (success)
+  if (success) {
     *esp = PHYS_BASE;
+    thread_current()->pages.stack_bottom = entry->uaddr;
+  }
   else
     printf("Setting up of the stack failed. In process.c/setup_stack()\n");
 #else
@@ -22,6 +22,11 @@
 #include "filesys/inode.h"
 #include "filesys/path.h"
 
+#ifdef VM
+  #include "vm/mmap.h"
+  #include "vm/page.h"
+#endif
+
 // Forward declarations of functions
 static void syscall_handler(struct intr_frame *);
 
@@ -48,6 +53,9 @@ void sysreaddir_handler(struct intr_frame* f);
 void sysisdir_handler(struct intr_frame* f);
 void sysinumber_handler(struct intr_frame* f);
 
+void sysfork_handler(struct intr_frame* f);
+void syssetrss_handler(struct intr_frame* f);
+
 uint32_t pop_stack(struct intr_frame *f);
 
 struct fileHandle* get_handle(int fd);
@@ -72,6 +80,7 @@ get_user(const uint32_t *uaddr)
   return -1;
 }
 
+#ifndef VM
 /* Writes BYTE to user address UDST.
 * UDST must be below PHYS_BASE
 * Returns true if successful, false if a segfault occurred.
@@ -90,6 +99,94 @@ put_user(uint8_t *udst, uint8_t byte)
 
   return false;
 }
+#endif
+
+/* Reads SIZE bytes from the file open as FD into BUFFER, which the kernel
+* can access without faulting.
+* Returns the number of bytes read, or -1 if FD is not an open file.
+*/
+static int
+read_buffer(int fd, void *buffer, unsigned size)
+{
+  struct fileHandle *fhp = get_handle(fd);
+
+  if (fhp && fhp->file) {
+    return file_read(fhp->file, buffer, size);
+  }
+
+  // File descriptor not found: return -1
+  return -1;
+}
+
+/* Writes SIZE bytes from BUFFER, which the kernel can access without
+* faulting, to the console or the file open as FD.
+* Returns the number of bytes written, or -1 if FD cannot be written.
+*/
+static int
+write_buffer(int fd, const void *buffer, unsigned size)
+{
+  // Check to see if it's a console out, and print if yes
+  if (fd == 1) {
+    putbuf((const char *) buffer, size);
+    return size;
+  }
+
+  // Not to console, so print to file
+  if (fd > 1) {
+    struct fileHandle *fhp = get_handle(fd);
+
+    if (fhp != NULL && fhp->file) {
+      return file_write(fhp->file, buffer, size);
+    }
+  }
+
+  return -1;
+}
+
+#ifdef VM
+/* Reads into the user BUFFER from FD if READ, else writes it to FD, one
+* pinned chunk at a time. A chunk is faulted in and pinned, since the file
+* system must not fault, and unpinned before the next one, so that a large
+* buffer never holds down more frames than eviction can spare.
+* Terminates the process if BUFFER does not belong to it, where ESP is the
+* user stack pointer, to tell stack buffers from wild pointers.
+* Returns the number of bytes transferred, or -1 if FD cannot be used.
+*/
+static int
+transfer_pinned(int fd, uint8_t *buffer, unsigned size, bool read,
+                const void *esp)
+{
+  int total = 0;
+
+  do {
+    size_t chunk = page_pin_chunk(buffer, size);
+    int cnt;
+
+    if (!page_pin_range(buffer, chunk, read, esp)) {
+      terminate_thread();
+    }
+
+    cnt = read ? read_buffer(fd, buffer, chunk)
+               : write_buffer(fd, buffer, chunk);
+    page_unpin_range(buffer, chunk);
+
+    if (cnt < 0) {
+      return total > 0 ? total : -1;
+    }
+
+    total += cnt;
+    buffer += cnt;
+    size -= cnt;
+
+    // Short transfer: end of file
+    if ((size_t) cnt < chunk) {
+      break;
+    }
+  } while (size > 0);
+
+  return total;
+}
+#endif
 
 /* Given an interrupt frame pointer, return the value pointed to by f->esp,
 * and increment f->esp.
@@ -124,6 +221,9 @@ syscall_handler(struct intr_frame *f)
   // It's easier to pop the stack as we go, so we will need to reset it
   void *tmpesp = f->esp;
 
+  // Faults on user memory from here on are checked against this esp
+  thread_current()->user_esp = f->esp;
+
   // Examine user memory to find out which system call gets called
   int syscall_number = pop_stack(f);
 
@@ -189,6 +289,12 @@ syscall_handler(struct intr_frame *f)
     case SYS_INUMBER:
       sysinumber_handler(f);
       break;
+    case SYS_FORK:
+      sysfork_handler(f);
+      break;
+    case SYS_SETRSS:
+      syssetrss_handler(f);
+      break;
   }
 
   // Replace stack pointer back to where it was for the application
@@ -318,16 +424,7 @@ void syscreate_handler(struct intr_frame *f)
     terminate_thread();
   }
 
-  char *abspath = path_abspath(filename);
-  if (abspath == NULL) {
-    // Too deep
-    f->eax = 0;
-    return;
-  }
-  else {
-    free(abspath);
-    f->eax = filesys_create(filename, filesize);
-  }
+  f->eax = filesys_create(filename, filesize);
 }
 
 /**
@@ -343,23 +440,14 @@ void sysremove_handler(struct intr_frame *f)
   // Get file name from stack
   char *filename = (char*) pop_stack(f);
   
-  char *abspath = path_abspath(filename);
-  if (abspath == NULL) {
-    // Too deep
+  // A directory that is some process' current directory is still open, so
+  // dir_remove refuses it
+  if (path_isroot(filename) ||
+      (path_isdir(filename) && !dir_is_empty(filename))) {
     f->eax = 0;
-    return;
   }
   else {
-    if (path_isroot(filename) ||
-        (path_isdir(filename) && !dir_is_empty(filename)) ||
-        (!strcmp(abspath, path_cwd()))) {
-      free(abspath);
-      f->eax = 0;
-    }
-    else {
-      free(abspath);
-      f->eax = filesys_remove(filename);
-    }
+    f->eax = filesys_remove(filename);
   }
 }
 
@@ -480,6 +568,10 @@ void sysread_handler(struct intr_frame *f)
   }
   else
   {
+#ifdef VM
+    f->eax = transfer_pinned(fd, buffer, size, true,
+                             thread_current()->user_esp);
+#else
     // Check to make sure buffer is in user space
     if (get_user(buffer) == -1)
     {
@@ -491,20 +583,8 @@ void sysread_handler(struct intr_frame *f)
       terminate_thread();
     }
 
-    struct fileHandle *fhp = get_handle(fd);
-
-    if (fhp) {
-      if (fhp->file) {
-        f->eax = file_read(fhp->file, buffer, size);
-      }
-      else {
-        f->eax = -1;
-      }
-    }
-    else {
-      // File descriptor not found: return -1
-      f->eax = -1;
-    }
+    f->eax = read_buffer(fd, buffer, size);
+#endif
   }
 }
 
@@ -534,30 +614,12 @@ void syswrite_handler(struct intr_frame *f)
   void* buffer = (void*) pop_stack(f);              // UVAS address  of buffer
   uint32_t bufferSize = (uint32_t) pop_stack(f);    // size of buffer to write
 
-  // Check to see if it's a console out, and print if yes
-  if (fdnum == 1)
-  {
-    putbuf((char *) buffer, bufferSize);
-    f->eax = bufferSize;
-  }
-  // Not to console, so print to file
-  else if (fdnum > 1)
-  {
-    struct fileHandle *fhp = get_handle(fdnum);
-
-    // Is the file currently executing?
-    if (fhp != NULL && fhp->file) {
-      f->eax = file_write(fhp->file, buffer, bufferSize);
-    }
-    else
-    {
-      f->eax = -1;
-    }
-  }
-  else
-  {
-    f->eax = -1;
-  }
+#ifdef VM
+  f->eax = transfer_pinned(fdnum, buffer, bufferSize, false,
+                           thread_current()->user_esp);
+#else
+  f->eax = write_buffer(fdnum, buffer, bufferSize);
+#endif
 }
 
 /**
@@ -666,6 +728,13 @@ void sysmmap_handler(struct intr_frame* f)
 
   if (fd != 0 && fd != 1 && pg_ofs(addr) == 0)
   {
+#ifdef VM
+    struct fileHandle *fhp = get_handle(fd);
+
+    // Only regular files can be mapped
+    if (fhp != NULL && fhp->file != NULL)
+      ret = mmap_map(fhp->file, addr);
+#endif
   }
 
   f->eax = ret;
@@ -681,6 +750,10 @@ void sysmmap_handler(struct intr_frame* f)
 void sysmunmap_handler(struct intr_frame* f)
 {
   int mapid = (int) pop_stack(f);
+
+#ifdef VM
+  mmap_unmap(mapid);
+#endif
 }
 
 
@@ -743,11 +816,14 @@ void sysmkdir_handler(struct intr_frame* f)
 
   // Quick check so we don't have to call into the fs if we don't need to
   bool success;
+  char *parent = path_dirname(dir);
   success = (
+              parent != NULL &&        // out of memory
               path_isvalid(dir) &&     // valid path name
               !path_isdir(dir) &&      // directory doesn't already exist
-              path_isdir(path_dirname(path_abspath(dir)))  // parent exists
+              path_isdir(parent)       // parent exists
             );
+  free(parent);
   if (success) {
     success = filesys_mkdir(dir);
   }
@@ -867,3 +943,56 @@ void terminate_thread(void)
   thread_set_exit_status(thread_current()->tid, -1);
   thread_exit();
 }
+
+/**
+ * pid_t fork (void)
+ *
+ * Creates a new process that is a copy of the calling one: same memory,
+ * same open files and current directory. Both return from fork, the child
+ * with 0 and the parent with the child's pid, which it may wait for.
+ * Returns -1 if the process cannot be copied. Memory is shared
+ * copy-on-write, and memory mapped files are not inherited.
+ */
+void sysfork_handler(struct intr_frame *f)
+{
+#ifdef VM
+  // The child returns from this same system call, with the user stack as
+  // it was on entry
+  struct intr_frame child_if = *f;
+  child_if.esp = (uint32_t *) f->esp - 1;
+  f->eax = process_fork(&child_if);
+#else
+  f->eax = -1;
+#endif
+}
+
+/**
+ * bool setrss (unsigned soft, unsigned hard)
+ *
+ * Sets the resident set limits of the calling process, in frames, 0 for
+ * none. Above the soft limit, eviction takes the process' frames first;
+ * at the hard limit, the process replaces its own pages. Processes it
+ * starts afterwards with exec or fork get the same limits, so a parent
+ * sets them for a program just before running it. Returns false, leaving
+ * the limits as they were, if the soft limit is above the hard one.
+ */
+void syssetrss_handler(struct intr_frame *f)
+{
+  unsigned soft = (unsigned) pop_stack(f);
+  unsigned hard = (unsigned) pop_stack(f);
+
+  bool success = (hard == 0 || soft <= hard);
+
+#ifdef VM
+  if (success) {
+    struct page_table *pt = &thread_current()->pages;
+    pt->rss_soft = soft;
+    pt->rss_hard = hard;
+  }
+#else
+  // Without VM there is no resident set to limit
+  success = false;
+#endif
+
+  f->eax = success;
+}
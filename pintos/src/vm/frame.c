@@ -40,27 +40,58 @@ of this project.
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/page.h"
+#include "vm/share.h"
 
 #include "userprog/pagedir.h"
 
-#include "lib/kernel/list.h"
 #include "lib/debug.h"
+#include "lib/round.h"
 #include "lib/string.h"
 
 #include "threads/thread.h"
-#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/interrupt.h"
 
 #include "stdio.h"
 
-static struct list all_frames;          // all allocated frames in the system
-static struct list_elem *clockhand;     // the eviction clock hand
+static struct frame *frame_table;       // one entry per user pool page
+static size_t frame_slots;              // number of entries in the table
+static uint8_t *user_base;              // first page of the user pool
+static size_t clockhand;                // the eviction clock hand
 
 static struct semaphore clock_sema;     // Protect eviction (uses clock)
-
-struct frame* evict_frame(void);
+static struct semaphore pin_sema;       // Buffer pin chunks still allowed
+static size_t pin_chunk_pages;          // Pages in one buffer pin chunk
+
+/// Replacement policy, set by the "-evict" kernel command line option
+enum frame_policy frame_evict_policy = FRAME_EVICT_CLOCK;
+
+static int age_ticks;                   // Ticks since the last aging sweep
+static int age_pending;                 // Sweeps owed by the timer
+static struct semaphore age_sema;       // Held by the thread sweeping
+
+/// Resident set limits given to the processes the kernel starts, in frames,
+/// 0 for none. Set by the "-rss-soft" and "-rss-hard" kernel command line
+/// options. A process changes its own with setrss(), and passes them on to
+/// the processes it starts.
+size_t rss_soft_limit = 0;
+size_t rss_hard_limit = 0;
+
+static size_t frame_cnt;                // Frames in the frame table
+static size_t resident_cnt;             // Processes owning at least a frame
+
+struct frame* evict_frame(int tid);
+static struct frame* clock_select(void);
+static struct frame* aging_select(void);
+static struct frame* local_select(int tid);
+static void frame_age(void);
+static struct page_table* owner_table(int tid);
+static bool is_over_share(struct frame *fp);
+static void ws_reset(struct thread *t, void *aux);
+static void ws_update(struct thread *t, void *aux);
+static bool is_zero_page(const void *kpage);
+static size_t clock_advance(void);
 
 /*================== METHODS TO QUERY/SET STATUS OF FRAME =================*/
 inline bool is_free(struct frame *fp);
@@ -70,6 +101,14 @@ inline void set_dirty(struct frame *fp, bool dirty);
 inline void set_accessed(struct frame *fp, bool accessed);
 inline bool is_readonly(struct frame *fp);
 inline bool is_pinned(struct frame* fp);
+uint32_t* frame_pagedir(struct frame *fp);
+
+/// Return the page directory of the process owning the frame, or NULL if
+/// that process is gone. Not static: the inline accessors below use it.
+uint32_t* frame_pagedir(struct frame *fp) {
+  struct thread *t = thread_by_tid(fp->tid);
+  return (t != NULL) ? t->pagedir : NULL;
+}
 
 /// Return true if the frame is not currently in use
 inline bool is_free(struct frame *fp) {
@@ -81,39 +120,56 @@ inline bool is_free(struct frame *fp) {
 inline bool is_dirty(struct frame *fp) {
   ASSERT(fp != NULL);
   ASSERT(!is_free(fp));
-  return (pagedir_is_dirty(thread_current()->pagedir, fp->upage->uaddr) ||
-          pagedir_is_dirty(thread_current()->pagedir, fp->kpage));
+  uint32_t *pd = frame_pagedir(fp);
+  if (pd == NULL)
+    return false;
+  return (pagedir_is_dirty(pd, fp->upage->uaddr) ||
+          pagedir_is_dirty(pd, fp->kpage));
 }
 
 /// Return true if the access bit for the frame is set
 inline bool is_accessed(struct frame *fp) {
   ASSERT(fp != NULL);
   ASSERT(!is_free(fp));
-  return (pagedir_is_accessed(thread_current()->pagedir, fp->upage->uaddr) ||
-          pagedir_is_accessed(thread_current()->pagedir, fp->kpage));
+  if (fp->share != NULL && share_is_accessed(fp->share))
+    return true;
+  uint32_t *pd = frame_pagedir(fp);
+  if (pd == NULL)
+    return false;
+  return (pagedir_is_accessed(pd, fp->upage->uaddr) ||
+          pagedir_is_accessed(pd, fp->kpage));
 }
 
 /// Set the dirty bit for the frame
 inline void set_dirty(struct frame *fp, bool dirty) {
   ASSERT(fp != NULL);
   ASSERT(!is_free(fp));
-  pagedir_set_dirty(thread_current()->pagedir, fp->upage->uaddr, dirty);
-  pagedir_set_dirty(thread_current()->pagedir, fp->kpage, dirty);
+  uint32_t *pd = frame_pagedir(fp);
+  if (pd == NULL)
+    return;
+  pagedir_set_dirty(pd, fp->upage->uaddr, dirty);
+  pagedir_set_dirty(pd, fp->kpage, dirty);
 }
 
 /// Set the access bit for the frame
 inline void set_accessed(struct frame *fp, bool accessed) {
   ASSERT(fp != NULL);
   ASSERT(!is_free(fp));
-  pagedir_set_accessed(thread_current()->pagedir, fp->upage->uaddr, accessed);
-  pagedir_set_accessed(thread_current()->pagedir, fp->kpage, accessed);
+  if (fp->share != NULL)
+    share_set_accessed(fp->share, accessed);
+  uint32_t *pd = frame_pagedir(fp);
+  if (pd == NULL)
+    return;
+  pagedir_set_accessed(pd, fp->upage->uaddr, accessed);
+  pagedir_set_accessed(pd, fp->kpage, accessed);
 }
 
-/// Return true if the frame cannot be written to
+/// Return true if the frame cannot be written to. Shared frames are
+/// always mapped read-only.
 inline bool is_readonly(struct frame *fp) {
   ASSERT(fp != NULL);
   ASSERT(!is_free(fp));
-  return (fp->upage->writable == false);
+  return (fp->upage->writable == false || fp->share != NULL);
 }
 
 /// Return true if the frame is pinned, thus not evictable
@@ -134,12 +190,180 @@ void unpin_frame(struct frame* fp) {
   fp->pinned = false;
 }
 
+/// Return the most pages a system call buffer may pin at once
+size_t frame_pin_max(void) {
+  return pin_chunk_pages;
+}
+
+/// Wait until a chunk of up to frame_pin_max() frames may be pinned for a
+/// system call buffer
+void frame_reserve_pins(void) {
+  sema_down(&pin_sema);
+}
+
+/// Give back a chunk taken with frame_reserve_pins()
+void frame_release_pins(void) {
+  sema_up(&pin_sema);
+}
+
 /*=========================================================================*/
 
-/// Initialize the frame table system
+/// Initialize the frame table system. The table is a single array covering
+/// the whole user pool, so that the frame of a kernel page is found by
+/// indexing and the clock sweeps it in address order.
 void frame_init(void) {
-  list_init(&all_frames);
+  size_t table_pages;
+
+  user_base = palloc_user_pool(&frame_slots);
+  table_pages = DIV_ROUND_UP(frame_slots * sizeof *frame_table, PGSIZE);
+  frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, table_pages);
+  clockhand = 0;
+
   sema_init(&clock_sema, 1);
+  age_ticks = 0;
+  age_pending = 0;
+  sema_init(&age_sema, 1);
+  frame_cnt = 0;
+  resident_cnt = 0;
+
+  // System call buffers may pin at most half of the user pool, so that
+  // eviction always finds a frame no matter how many of them run at once
+  pin_chunk_pages = frame_slots / 2 < PAGE_PIN_MAX ? frame_slots / 2
+                                                   : PAGE_PIN_MAX;
+  if (pin_chunk_pages == 0)
+    pin_chunk_pages = 1;
+  sema_init(&pin_sema, frame_slots / 2 / pin_chunk_pages > 0
+                       ? frame_slots / 2 / pin_chunk_pages : 1);
+}
+
+/// Called by thread_tick() on every timer interrupt. The aging sweep
+/// itself touches every frame and page directory, so it is not run in
+/// interrupt context: we only record that a sweep is owed, and frame_age()
+/// pays the debt from thread context the next time a frame is allocated.
+void frame_tick(void) {
+  if (++age_ticks >= FRAME_AGE_INTERVAL) {
+    age_ticks = 0;
+    age_pending++;
+  }
+}
+
+/// Shift the reference history of every frame by the number of sweeps
+/// owed, folding the accessed bit into the most significant bit.
+/// If several sweeps are pending, the accessed bit is credited to the
+/// latest one, which slightly overestimates the page's recency.
+/// The histories also give each process' working set: the frames it
+/// referenced within the last FRAME_WS_MASK sweeps.
+/// Each frame is visited in its own interrupts-off section, so a sweep
+/// never keeps interrupts off for longer than one frame's owner lookup.
+/// One thread sweeps at a time; the others leave the debt to it.
+static void frame_age(void) {
+  size_t i;
+  int shift;
+
+  if (!sema_try_down(&age_sema))
+    return;
+
+  enum intr_level old_level = intr_disable();
+  shift = age_pending;
+  age_pending = 0;
+  if (shift > 0)
+    thread_foreach(ws_reset, NULL);
+  intr_set_level(old_level);
+
+  if (shift == 0) {
+    sema_up(&age_sema);
+    return;
+  }
+  if (shift > 8)
+    shift = 8;
+
+  for (i = 0; i < frame_slots; i++) {
+    struct frame *fp = &frame_table[i];
+
+    old_level = intr_disable();
+    if (fp->kpage == NULL || is_free(fp)) {
+      intr_set_level(old_level);
+      continue;
+    }
+
+    // Each sweep consumes the accessed bit, so that a single reference
+    // ages out. The clock keeps its own copy for the second chance.
+    fp->age >>= shift;
+    if (is_accessed(fp)) {
+      fp->age |= 0x80;
+      fp->referenced = true;
+      set_accessed(fp, false);
+    }
+
+    if (fp->age & FRAME_WS_MASK) {
+      struct page_table *pt = owner_table(fp->tid);
+      if (pt != NULL)
+        pt->ws_sample++;
+    }
+    intr_set_level(old_level);
+  }
+
+  old_level = intr_disable();
+  thread_foreach(ws_update, NULL);
+  intr_set_level(old_level);
+  sema_up(&age_sema);
+}
+
+/// Start a working set sample for thread T
+static void ws_reset(struct thread *t, void *aux UNUSED) {
+  t->pages.ws_sample = 0;
+}
+
+/// Publish the working set sampled for thread T
+static void ws_update(struct thread *t, void *aux UNUSED) {
+  t->pages.wss = t->pages.ws_sample;
+}
+
+/// Return the page table of the process TID, or NULL if it is gone
+static struct page_table* owner_table(int tid) {
+  struct thread *t = thread_by_tid(tid);
+  return (t != NULL) ? &t->pages : NULL;
+}
+
+/// Hand frame FP over to UPAGE, or to nobody if UPAGE is NULL, keeping the
+/// resident set sizes of the old and new owners up to date
+void frame_set_owner(struct frame *fp, struct page_entry *upage) {
+  ASSERT(fp != NULL);
+  struct page_table *pt;
+
+  enum intr_level old_level = intr_disable();
+  if (fp->upage != NULL) {
+    pt = owner_table(fp->tid);
+    if (pt != NULL && pt->rss > 0 && --pt->rss == 0)
+      resident_cnt--;
+  }
+
+  fp->upage = upage;
+  if (upage != NULL) {
+    fp->tid = upage->tid;
+    pt = owner_table(fp->tid);
+    if (pt != NULL && pt->rss++ == 0)
+      resident_cnt++;
+  }
+  intr_set_level(old_level);
+}
+
+/// Return true if the owner of FP holds more than its share of memory, so
+/// that its frames should be evicted first. With a soft limit, the share is
+/// the limit. Otherwise it is an even split of the frames between resident
+/// processes, though a process is never over its share while it actually
+/// uses all of its frames.
+static bool is_over_share(struct frame *fp) {
+  struct page_table *pt = owner_table(fp->tid);
+  size_t fair;
+
+  if (pt == NULL)
+    return true;
+  if (pt->rss_soft != 0)
+    return pt->rss > pt->rss_soft;
+
+  fair = frame_cnt / (resident_cnt > 0 ? resident_cnt : 1);
+  return (pt->rss > fair && pt->rss > pt->wss);
 }
 
 /// Obtain a new frame to hold the page pointed to by UPAGE
@@ -158,30 +382,43 @@ struct frame* allocate_frame(struct page_entry* upage) {
   uaddr = upage->uaddr;
   uaddr = (void*)((((uint32_t) uaddr) / PGSIZE) * PGSIZE);
 
+  // Bring reference histories up to date before they are consulted
+  frame_age();
+
+  // A process at its hard limit replaces its own pages
+  struct page_table *pt = owner_table(upage->tid);
+  fp = NULL;
+  if (pt != NULL && pt->rss_hard != 0 && pt->rss >= pt->rss_hard)
+    fp = evict_frame(upage->tid);
+
   // Attempt to allocate a new frame
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage == NULL) {
+  kpage = (fp == NULL) ? palloc_get_page (PAL_USER | PAL_ZERO) : NULL;
+  if (fp != NULL) {
+    // Reuse the frame we took from ourselves
+  }
+  else if (kpage == NULL) {
     // All physical addresses are used: evict a frame
-    fp = evict_frame();
+    fp = evict_frame(0);
   }
   else {
-    // We have space: register a new frame to track the address
-    fp = malloc(sizeof(struct frame));
-    fp->kpage = kpage;
-    fp->pinned = false;
-    fp->async_write = false;
-
+    // We have space: claim the table entry of the new page
+    fp = frame_lookup(kpage);
     ASSERT(fp != NULL);
-    ASSERT(!is_pinned(fp));
 
     enum intr_level old_level = intr_disable();
-    list_push_back(&all_frames, &fp->elem);
+    fp->upage = NULL;
+    fp->pinned = false;
+    fp->async_write = false;
+    fp->share = NULL;
+    fp->kpage = kpage;
+    frame_cnt++;
     intr_set_level(old_level);
   }
 
-  // Set frame attributes
-  fp->upage = upage;
-  fp->tid = upage->tid;
+  // Set frame attributes; a page being faulted in counts as just used
+  frame_set_owner(fp, upage);
+  fp->age = 0x80;
+  fp->referenced = false;
   
   // Update page entry attributes
   upage->frame = fp;
@@ -230,9 +467,9 @@ bool install_frame(struct frame* fp, int writable)
 void free_frame(struct frame* fp)
 {
   ASSERT(fp != NULL);
-  ASSERT(fp->upage != NULL);
-  ASSERT(fp->upage->frame != NULL);
-  ASSERT(fp->upage->uaddr != NULL);
+  ASSERT(fp->share == NULL);
+  ASSERT(fp->upage == NULL || fp->upage->frame != NULL);
+  ASSERT(fp->upage == NULL || fp->upage->uaddr != NULL);
 
   // Remove page->frame mapping from the CPU-based page directory
   if (fp != NULL) {
@@ -248,53 +485,175 @@ void free_frame(struct frame* fp)
 
       // Remove page<->frame mapping from our supplemental structures
       fp->upage->frame = NULL;
-      fp->upage = NULL;
+      frame_set_owner(fp, NULL);
     }
     enum intr_level old_level = intr_disable();
     palloc_free_page(fp->kpage);
-    list_remove(&fp->elem);
-    free(fp);
+    fp->kpage = NULL;
+    frame_cnt--;
     intr_set_level(old_level);
   }
 }
 
-struct frame* evict_frame(void)
+/// Return the frame table entry of the user pool page KPAGE
+struct frame* frame_lookup(const void *kpage) {
+  ASSERT(pg_ofs(kpage) == 0);
+  size_t i = ((const uint8_t *) kpage - user_base) / PGSIZE;
+
+  ASSERT((const uint8_t *) kpage >= user_base && i < frame_slots);
+  return &frame_table[i];
+}
+
+/// Return the number of user pool pages not in the frame table
+size_t frame_free_count(void) {
+  return frame_slots - frame_cnt;
+}
+
+/// Return the index of the allocated frame under the clock hand, and move
+/// the hand past it. There must be at least one allocated frame.
+static size_t clock_advance(void) {
+  size_t i;
+
+  enum intr_level old_level = intr_disable();
+  do {
+    i = clockhand;
+    clockhand = (clockhand + 1 < frame_slots) ? clockhand + 1 : 0;
+  } while (frame_table[i].kpage == NULL);
+  intr_set_level(old_level);
+
+  return i;
+}
+
+/// Evict a frame and return it, free. If TID is not 0, the victim is one of
+/// the frames of process TID, and NULL is returned if it has none to give.
+struct frame* evict_frame(int tid)
 {
+  sema_down(&clock_sema);
 
+  struct frame *fp;
+  if (tid != 0)
+    fp = local_select(tid);
+  else if (frame_evict_policy == FRAME_EVICT_AGING)
+    fp = aging_select();
+  else
+    fp = clock_select();
+
+  if (fp == NULL) {
+    sema_up(&clock_sema);
+    return NULL;
+  }
+  if (tid != 0)
+    vmstat_count(VMSTAT_EVICT_LOCAL);
+  ASSERT(fp->kpage != NULL);
+  ASSERT(!is_pinned(fp));
+
+  pin_frame(fp);
+  if (fp->upage != NULL) {
+    bool shared = (fp->share != NULL && !fp->share->anon);
+    if (fp->share != NULL && fp->share->anon) {
+      // Memory of forked processes: the others get swap copies, and the
+      // owner's copy is written out below like a private frame
+      share_swap_out(fp->share);
+    }
+    else if (shared) {
+      // Shared frames match their file: unmap them everywhere
+      share_unmap_all(fp->share);
+    }
+    else {
+      // Unmap frame if the frame is being used
+      struct thread *victim = thread_by_tid(fp->tid);
+      pagedir_clear_page(victim->pagedir, fp->upage->uaddr);
+    }
+
+    // Write to the mapped file, or else to swap space, if the frame is dirty
+    if (fp->upage->mmap) {
+      if (is_dirty(fp) || fp->async_write) {
+        page_write_back(fp->upage);
+        vmstat_count(VMSTAT_EVICT_FILE);
+      }
+      else
+        vmstat_count(VMSTAT_EVICT_CLEAN);
+      fp->async_write = false;
+    }
+    else if (!shared && !is_readonly(fp) && (is_dirty(fp) || fp->async_write)) {
+      if (is_zero_page(fp->kpage)) {
+        // Nothing worth saving: the page will fault back in as zeros
+        fp->upage->read_bytes = 0;
+        fp->upage->cow = false;
+        vmstat_count(VMSTAT_EVICT_ZERO);
+      }
+      else {
+        push_to_swap(fp);
+        vmstat_count(VMSTAT_EVICT_SWAP);
+
+        // Remember working set pages sent to disk, to read them back
+        // together when the process faults on one of them
+        struct page_table *pt = owner_table(fp->tid);
+        struct swap_slot *slot = fp->upage->swap;
+        if ((fp->age & FRAME_WS_MASK) && pt != NULL && slot != NULL &&
+            slot->zentry == NULL) {
+          fp->upage->ws = true;
+          pt->ws_swapped++;
+        }
+      }
+      fp->async_write = false;
+    }
+    else
+      vmstat_count(shared ? VMSTAT_EVICT_SHARED : VMSTAT_EVICT_CLEAN);
+
+    // Clear frame out to zero
+    memset(fp->kpage, 0, PGSIZE);
+
+    fp->upage->frame = NULL;
+    frame_set_owner(fp, NULL);
+  }
+
+  unpin_frame(fp);
+  ASSERT(fp != NULL);
+  ASSERT(fp->kpage != NULL);
+  ASSERT(fp->upage == NULL);
+  ASSERT(!is_pinned(fp));
+  sema_up(&clock_sema);
+  return fp;
+}
+
+/// Return true if every byte of the page at KPAGE is zero
+static bool is_zero_page(const void *kpage) {
+  const uint32_t *word = kpage;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *word; i++)
+    if (word[i] != 0)
+      return false;
+  return true;
+}
+
+/// Pick an eviction victim with the second chance clock. Must be called
+/// with CLOCK_SEMA held.
+static struct frame* clock_select(void)
+{
   /*************************************
   **                                  **
   **  USING SECOND CHANCE ALGORITHM   **
   **                                  **
   *************************************/
-  sema_down(&clock_sema);
-  enum intr_level old_level = intr_disable();
-  if (clockhand == NULL || clockhand == list_end(&all_frames))
-    clockhand = list_begin(&all_frames);
-  intr_set_level(old_level);
-
+  size_t first = clock_advance();   // frame the hand started at
+  size_t i = first;
   int revolution = 0;   // number of revolutions of the clockhand
   bool found = false;   // true if we have found an eviction target
   struct frame *fp = NULL;
-  struct list_elem *old_clockhand = clockhand;  // saved clockhand position
 
-  while (revolution < 3 && !found) {
-    ASSERT(clockhand->next != clockhand);
-    ASSERT(clockhand != list_end(&all_frames));
-    ASSERT(clockhand != NULL);
-
-    // Get the frame structure
-    old_level = intr_disable();
-    fp = list_entry(clockhand, struct frame, elem);
-    ASSERT(fp != NULL);
-    intr_set_level(old_level);
+  do {
+    fp = &frame_table[i];
 
     // Check if the frame is suitable for eviction
     if (revolution == 0) {
-      // first time through
+      // first time through: only processes over their share lose pages
       found = (!is_pinned(fp) &&
                (is_free(fp) ||
-                is_readonly(fp) ||
-                (!is_accessed(fp) && !is_dirty(fp))));
+                ((is_readonly(fp) ||
+                  (!is_accessed(fp) && !fp->referenced && !is_dirty(fp))) &&
+                 is_over_share(fp))));
     }
     else if (revolution == 1) {
       // second time through
@@ -310,55 +669,129 @@ struct frame* evict_frame(void)
 
     // Set accessed to false at every frame
     set_accessed(fp, false);
+    fp->referenced = false;
 
     // Reset dirty bit (remembering to write later if evicted)
     if (is_dirty(fp)) {
       set_dirty(fp, false);
       fp->async_write = true;
     }
+    vmstat_count(VMSTAT_CLOCK_SCAN);
+    if (found)
+      break;
 
-    // Advance clockhand
-    old_level = intr_disable();
-    clockhand = list_next(clockhand);
-    if (clockhand == list_end(&all_frames) || clockhand == NULL)
-      clockhand = list_begin(&all_frames);
-    intr_set_level(old_level);
-
-    // Increment revolution if we passed the saved position
-    if (clockhand == old_clockhand)
+    // Advance clockhand, counting a revolution when back at the start
+    i = clock_advance();
+    if (i == first) {
       revolution++;
-  }
+      vmstat_count(VMSTAT_CLOCK_REVOLUTION);
+    }
+  } while (revolution < 3);
+
   ASSERT(found);
-  ASSERT(fp != NULL);
-  ASSERT(fp->kpage != NULL);
-  ASSERT(!is_pinned(fp));
+  return fp;
+}
 
-  pin_frame(fp);
-  if (fp->upage != NULL) {
-    // Unmap frame if the frame is being used
-    struct thread *victim = thread_by_tid(fp->tid);
-    pagedir_clear_page(victim->pagedir, fp->upage->uaddr);
+/// Pick an eviction victim WSClock style, using the aging counters.
+/// Frames are ranked by tier: old (no reference recorded in the last 8
+/// sweeps) and clean, so that no write is needed, then old and dirty, then
+/// young, with ties going to the smallest reference history. Frames of
+/// processes over their share of memory come before all others, so that
+/// a process keeps its working set while another one is thrashing.
+/// Must be called with CLOCK_SEMA held.
+static struct frame* aging_select(void)
+{
+  size_t first = clock_advance();   // frame the hand started at
+  size_t i = first;
+  struct frame *best = NULL;        // best victim so far
+  uint8_t best_age = 0;             // its reference history
+  int best_score = 0;               // its rank, lower is better
+  bool full_turn = true;            // whether the hand went all around
+
+  do {
+    struct frame *fp = &frame_table[i];
+
+    vmstat_count(VMSTAT_CLOCK_SCAN);
+    if (is_pinned(fp))
+      continue;
+
+    if (is_free(fp)) {
+      best = fp;
+      full_turn = false;
+      break;
+    }
 
-    // Write to swap space if the frame is dirty
-    if (is_dirty(fp) || fp->async_write) {
-      push_to_swap(fp);
-      fp->async_write = false;
+    // A reference since the last sweep makes the frame young again
+    uint8_t age = fp->age;
+    if (is_accessed(fp))
+      age |= 0x80;
+
+    int score;
+    if (age != 0)
+      score = 2;
+    else if (is_readonly(fp) || (!is_dirty(fp) && !fp->async_write))
+      score = 0;
+    else
+      score = 1;
+    if (!is_over_share(fp))
+      score += 3;
+
+    if (best == NULL || score < best_score ||
+        (score == best_score && age < best_age)) {
+      best = fp;
+      best_age = age;
+      best_score = score;
+      if (score == 0) {
+        full_turn = false;
+        break;
+      }
     }
+  } while ((i = clock_advance()) != first);
 
-    // Clear frame out to zero
-    memset(fp->kpage, 0, PGSIZE);
+  if (full_turn)
+    vmstat_count(VMSTAT_CLOCK_REVOLUTION);
+  ASSERT(best != NULL);
+  return best;
+}
 
-    fp->upage->frame = NULL;
-    fp->upage = NULL;
+/// Pick a victim among the frames of process TID, for a process at its
+/// hard resident set limit. Frames neither accessed nor dirty come first,
+/// then frames not accessed, then any. Accessed bits are cleared on the
+/// way, giving the process' frames a clock of their own.
+/// Returns NULL if the process has no frame that can be evicted.
+/// Must be called with CLOCK_SEMA held.
+static struct frame* local_select(int tid)
+{
+  struct frame *best = NULL;        // best victim so far
+  int best_score = 0;               // its rank, lower is better
+  size_t i;
+
+  enum intr_level old_level = intr_disable();
+  for (i = 0; i < frame_slots; i++) {
+    struct frame *fp = &frame_table[i];
+
+    if (fp->kpage == NULL || is_free(fp) || fp->tid != tid ||
+        is_pinned(fp) || fp->share != NULL)
+      continue;
+
+    int score;
+    if (is_accessed(fp) || fp->referenced)
+      score = 2;
+    else if (is_dirty(fp) || fp->async_write)
+      score = 1;
+    else
+      score = 0;
+    set_accessed(fp, false);
+    fp->referenced = false;
+
+    if (best == NULL || score < best_score) {
+      best = fp;
+      best_score = score;
+      if (score == 0)
+        break;
+    }
   }
+  intr_set_level(old_level);
 
-  unpin_frame(fp);
-  ASSERT(found);
-  ASSERT(fp != NULL);
-  ASSERT(fp->kpage != NULL);
-  ASSERT(fp->upage == NULL);
-  ASSERT(!is_pinned(fp));
-  sema_up(&clock_sema);
-  return fp;
+  return best;
 }
-
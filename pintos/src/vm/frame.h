@@ -5,22 +5,53 @@
 #include "vm/page.h"
 #include "page.h"
 
+/// Page replacement policies, selected at boot with "-evict=POLICY"
+enum frame_policy {
+  FRAME_EVICT_CLOCK,          // Second chance clock on the accessed bits
+  FRAME_EVICT_AGING           // WSClock over 8-bit aging counters
+};
+
+/// Number of timer ticks between two aging sweeps
+#define FRAME_AGE_INTERVAL 4
+
+/// Reference history bits that make a frame part of its owner's working
+/// set: the frame was used in one of the last four sweeps
+#define FRAME_WS_MASK 0xF0
+
+extern enum frame_policy frame_evict_policy;
+extern size_t rss_soft_limit;
+extern size_t rss_hard_limit;
+
+/// An entry of the frame table, which has one for each page of the user
+/// pool. Entries whose KPAGE is NULL are not allocated.
 struct frame {
   int tid;
   struct page_entry *upage;   // User page
   void* kpage;                // Kernel page = Physical address
   bool pinned;                // A pinned frame cannot be evicted
   bool async_write;           // If true, must be written to swap on evict
-  struct list_elem elem;
+  uint8_t age;                // Reference history, MSB is the latest sweep
+  bool referenced;            // Accessed bit taken by aging, for the clock
+  struct share_entry *share;  // Set if the frame is shared between processes
 };
 
 void frame_init(void);
+void frame_tick(void);
 
 struct frame* allocate_frame(struct page_entry* upage);
 bool install_frame(struct frame *fp, int writable);
 void free_frame(struct frame *fp);
+struct frame* frame_lookup(const void *kpage);
+size_t frame_free_count(void);
+void frame_set_owner(struct frame *fp, struct page_entry *upage);
 
 void pin_frame(struct frame *fp);
 void unpin_frame(struct frame *fp);
+size_t frame_pin_max(void);
+void frame_reserve_pins(void);
+void frame_release_pins(void);
+
+bool is_dirty(struct frame *fp);
+void set_dirty(struct frame *fp, bool dirty);
 
 #endif /* vm/frame.h */
@@ -0,0 +1,135 @@
+/**
+ * Memory mapped files. A mapping is a run of page entries whose backing
+ * store is the mapped file itself: pages are faulted in lazily from the file
+ * like executable pages, and dirty pages are written back to the file, not
+ * to swap, when they are evicted, unmapped or when the process exits.
+ */
+#include "vm/mmap.h"
+#include "vm/page.h"
+
+#include "filesys/file.h"
+
+#include "lib/debug.h"
+#include "lib/round.h"
+
+#include "threads/thread.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "threads/interrupt.h"
+
+static struct mmap_entry* get_mmap_entry(int mapid);
+static void unmap_entry(struct mmap_entry *me);
+
+/// Map FILE into the current process at user address ADDR. Return the
+/// mapping ID, or -1 if the file is empty, ADDR is not page aligned, or the
+/// mapping would overlap pages the process already uses.
+int mmap_map(struct file *file, void *addr) {
+  struct thread *t = thread_current();
+  off_t length;
+  size_t page_cnt, i;
+
+  if (file == NULL || addr == NULL || pg_ofs(addr) != 0)
+    return -1;
+
+  length = file_length(file);
+  if (length <= 0)
+    return -1;
+  page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+  // The whole range must be free user memory
+  for (i = 0; i < page_cnt; i++) {
+    void *uaddr = (uint8_t *) addr + i * PGSIZE;
+    if (!is_user_vaddr(uaddr) || get_page_entry(uaddr) != NULL)
+      return -1;
+  }
+
+  struct mmap_entry *me = malloc(sizeof(struct mmap_entry));
+  if (me == NULL)
+    return -1;
+
+  // Keep our own handle so the mapping outlives the file descriptor
+  me->file = file_reopen(file);
+  if (me->file == NULL) {
+    free(me);
+    return -1;
+  }
+  me->addr = addr;
+  me->page_cnt = 0;
+
+  for (i = 0; i < page_cnt; i++) {
+    struct page_entry *entry = allocate_page((uint8_t *) addr + i * PGSIZE);
+    if (entry == NULL) {
+      unmap_entry(me);
+      return -1;
+    }
+    me->page_cnt++;
+
+    off_t offset = i * PGSIZE;
+    entry->file = me->file;
+    entry->offset = offset;
+    entry->read_bytes = (length - offset < PGSIZE) ? length - offset : PGSIZE;
+    entry->writable = true;
+    entry->mmap = true;
+  }
+
+  enum intr_level old_level = intr_disable();
+  me->mapid = t->nextMapid++;
+  list_push_back(&t->mmaps, &me->elem);
+  intr_set_level(old_level);
+
+  return me->mapid;
+}
+
+/// Unmap the mapping MAPID of the current process, writing modified pages
+/// back to the file. Return false if there is no such mapping.
+bool mmap_unmap(int mapid) {
+  struct mmap_entry *me = get_mmap_entry(mapid);
+  if (me == NULL)
+    return false;
+
+  enum intr_level old_level = intr_disable();
+  list_remove(&me->elem);
+  intr_set_level(old_level);
+
+  unmap_entry(me);
+  return true;
+}
+
+/// Unmap every mapping of the current process. Called on process exit,
+/// before the supplemental page table is destroyed.
+void mmap_destroy(void) {
+  struct thread *t = thread_current();
+
+  while (!list_empty(&t->mmaps)) {
+    enum intr_level old_level = intr_disable();
+    struct list_elem *e = list_pop_front(&t->mmaps);
+    intr_set_level(old_level);
+
+    unmap_entry(list_entry(e, struct mmap_entry, elem));
+  }
+}
+
+/// Look in the current thread's mappings for MAPID. Return NULL if none.
+static struct mmap_entry* get_mmap_entry(int mapid) {
+  struct thread *t = thread_current();
+  struct list_elem *e;
+
+  for (e = list_begin(&t->mmaps); e != list_end(&t->mmaps);
+       e = list_next(e)) {
+    struct mmap_entry *me = list_entry(e, struct mmap_entry, elem);
+    if (me->mapid == mapid)
+      return me;
+  }
+  return NULL;
+}
+
+/// Write back and free the pages of a mapping, then free the mapping
+static void unmap_entry(struct mmap_entry *me) {
+  size_t i;
+
+  for (i = 0; i < me->page_cnt; i++)
+    free_mapped_page((uint8_t *) me->addr + i * PGSIZE);
+
+  file_close(me->file);
+  free(me);
+}
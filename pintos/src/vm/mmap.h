@@ -0,0 +1,20 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include "lib/kernel/list.h"
+#include "filesys/file.h"
+
+/// A file mapped into a process' address space with mmap
+struct mmap_entry {
+  int mapid;                  // Mapping ID, unique within the process
+  struct file *file;          // Private handle on the mapped file
+  void *addr;                 // First mapped user page
+  size_t page_cnt;            // Number of pages mapped
+  struct list_elem elem;      // List element for thread-based mapping list
+};
+
+int mmap_map(struct file *file, void *addr);
+bool mmap_unmap(int mapid);
+void mmap_destroy(void);
+
+#endif /* vm/mmap.h */
@@ -59,8 +59,12 @@ page_fault() in "userprog/exception.c", needs to do roughly the following:
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
+
+#include "userprog/pagedir.h"
 
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/interrupt.h"
@@ -68,19 +72,58 @@ page_fault() in "userprog/exception.c", needs to do roughly the following:
 #include "lib/debug.h"
 
 #include <stdio.h>
+#include <string.h>
 
 static struct semaphore filesys_sema;   // Protect access to disks
 static struct semaphore paging_sema;    // Protect page loading
 
+/// Stack size limit in pages, set by the "-stack" kernel command line option
+size_t stack_page_limit = STACK_MAX_PAGES;
+
+static void *zero_page;                 // Shared frame of all zeros
+
+static void fault_around(struct page_entry *entry);
+static void prefetch_swap(void);
+static void clear_ws(struct page_entry *entry);
+static bool map_resident(struct page_entry *entry);
+static bool map_zero(struct page_entry *entry);
+static void unmap_zero(struct page_entry *entry);
+static void unpin_pages(const void *uaddr, size_t size);
+
 void page_init(void ) {
   sema_init(&filesys_sema, 1);
   sema_init(&paging_sema, 1);
+
+  // Never freed nor evicted: it is not in the frame table
+  zero_page = palloc_get_page(PAL_USER | PAL_ZERO | PAL_ASSERT);
 }
 
-/** Initialize a page table */
+/** Initialize the page table of a process the running thread starts */
 void page_table_init(struct page_table *pt)
 {
+  struct thread *parent = thread_current();
+
   list_init(&pt->pages);
+  pt->next_fault = NULL;
+  pt->window = 0;
+  pt->stack_bottom = PHYS_BASE;
+  pt->rss = 0;
+  pt->wss = 0;
+  pt->ws_sample = 0;
+
+  // Processes inherit the resident set limits of the process that started
+  // them, which may have changed its own with setrss(). Processes the
+  // kernel starts get the boot options.
+  if (parent->pagedir != NULL) {
+    pt->rss_soft = parent->pages.rss_soft;
+    pt->rss_hard = parent->pages.rss_hard;
+  }
+  else {
+    pt->rss_soft = rss_soft_limit;
+    pt->rss_hard = rss_hard_limit;
+  }
+  pt->ws_swapped = 0;
+  vmstat_init(&pt->stats);
 }
 
 /** Free all pages the page table points to. */
@@ -135,6 +178,12 @@ struct page_entry* allocate_page(void* uaddr)
 
     entry->offset = 0;
     entry->read_bytes = 0;
+    entry->mmap = false;
+    entry->zero = false;
+    entry->ws = false;
+
+    entry->cow = false;
+    entry->share = NULL;
 
     enum intr_level old_level = intr_disable();
     list_push_back(&(t->pages.pages), &entry->elem);
@@ -143,6 +192,48 @@ struct page_entry* allocate_page(void* uaddr)
   return entry;
 }
 
+/// Copy the pages of PARENT into the current process, which is being forked
+/// from it. Resident pages are shared copy-on-write, swapped out pages are
+/// copied to new swap slots, and pages the parent has not loaded yet will
+/// be loaded by the child from the same place. Memory mapped files are not
+/// inherited. Return false if out of memory or swap.
+bool page_table_fork(struct thread *parent)
+{
+  struct thread *t = thread_current();
+  struct list *pages = &parent->pages.pages;
+  struct list_elem *e;
+  bool success = true;
+
+  // Hold off eviction while the parent's pages are being looked at
+  sema_down(&paging_sema);
+  for (e = list_begin(pages); e != list_end(pages) && success;
+       e = list_next(e)) {
+    struct page_entry *p = list_entry(e, struct page_entry, elem);
+    if (p->mmap)
+      continue;
+
+    struct page_entry *c = allocate_page(p->uaddr);
+    if (c == NULL) {
+      success = false;
+      break;
+    }
+    c->writable = p->writable;
+    c->file = (p->file == parent->ownfile) ? t->ownfile : NULL;
+    c->offset = p->offset;
+    c->read_bytes = p->read_bytes;
+    c->cow = p->cow;
+
+    if (p->frame != NULL && (p->share == NULL || p->share->anon))
+      success = share_fork(p, c);
+    else if (p->swap != NULL)
+      success = swap_copy(p, c);
+  }
+  t->pages.stack_bottom = parent->pages.stack_bottom;
+  sema_up(&paging_sema);
+
+  return success;
+}
+
 /// Called by page_table_destroy for each page entry to free it.
 void free_page(void* uaddr)
 {
@@ -161,6 +252,17 @@ bool load_page_entry(struct page_entry* entry) {
 
   if (entry != NULL) {
     ASSERT(!is_present(entry));
+    // The page gets a frame of its own: drop any zero frame mapping
+    if (entry->zero)
+      unmap_zero(entry);
+
+    // Another process may already have the page in memory: share it
+    if (!is_swapped(entry) && share_is_shareable(entry) && share_map(entry)) {
+      vmstat_count(VMSTAT_SHARE_HIT);
+      sema_up(&paging_sema);
+      return true;
+    }
+
     // First get a free frame to put it in
     struct frame *fp = allocate_frame(entry);
     ASSERT(fp != NULL);
@@ -173,6 +275,7 @@ bool load_page_entry(struct page_entry* entry) {
     // Page is in swap: Read it in
     if (is_swapped(entry)) {
       // Page is swapped: swap it back into the free frame
+      clear_ws(entry);
       pull_from_swap(entry);
       success = install_frame(fp, entry->writable);
     }
@@ -186,11 +289,21 @@ bool load_page_entry(struct page_entry* entry) {
         int bytes_read = file_read(entry->file, fp->kpage,
                                    entry->read_bytes);
         sema_up(&filesys_sema);
+        vmstat_count(VMSTAT_FILE_IN);
         if (bytes_read != entry->read_bytes) {
           free_frame(fp);
         }
+        else if (share_is_shareable(entry)) {
+          // Map read-only so that writes break the sharing first
+          success = install_frame(fp, false);
+          if (success)
+            share_insert(entry);
+        }
         else {
           success = install_frame(fp, entry->writable);
+          // The file holds this data: only later writes make it dirty
+          if (success && entry->mmap)
+            set_dirty(fp, false);
         }
       }
       else {
@@ -215,23 +328,424 @@ bool load_page_entry(struct page_entry* entry) {
   return success;
 }
 
+/// Free a page of a memory mapped file, writing it back to the file first
+/// if it was modified.
+void free_mapped_page(void *uaddr)
+{
+  struct page_entry *entry = get_page_entry(uaddr);
+  if (entry == NULL)
+    return;
+
+  ASSERT(entry->mmap);
+  sema_down(&paging_sema);
+
+  // Keep the frame from being evicted while it is written back
+  enum intr_level old_level = intr_disable();
+  if (entry->frame != NULL)
+    pin_frame(entry->frame);
+  intr_set_level(old_level);
+
+  // The clock moves the dirty bit into ASYNC_WRITE as its hand passes
+  if (entry->frame != NULL &&
+      (is_dirty(entry->frame) || entry->frame->async_write)) {
+    page_write_back(entry);
+    entry->frame->async_write = false;
+  }
+
+  old_level = intr_disable();
+  list_remove(&entry->elem);
+  free_page_entry(entry);
+  intr_set_level(old_level);
+
+  sema_up(&paging_sema);
+}
+
+/// Write the frame of a memory mapped page back to its file. Bytes past the
+/// end of the file are discarded. Return true if successful.
+bool page_write_back(struct page_entry *entry)
+{
+  ASSERT(entry != NULL);
+  ASSERT(entry->mmap);
+  ASSERT(entry->frame != NULL);
+
+  sema_down(&filesys_sema);
+  off_t bytes_written = file_write_at(entry->file, entry->frame->kpage,
+                                      entry->read_bytes, entry->offset);
+  sema_up(&filesys_sema);
+  return (bytes_written == (off_t) entry->read_bytes);
+}
+
+/// Grow the current process' stack down to the page containing UADDR. The
+/// whole gap between the current stack bottom and UADDR is allocated at
+/// once, so that a deep call or a large frame takes a single fault.
+/// Return false if UADDR is beyond the stack limit or the gap overlaps
+/// other pages of the process.
+bool page_grow_stack(void *uaddr)
+{
+  struct page_table *pt = &thread_current()->pages;
+  uint8_t *limit = (uint8_t *) PHYS_BASE - stack_page_limit * PGSIZE;
+  uint8_t *bottom = pg_round_down(uaddr);
+  uint8_t *addr;
+
+  if (stack_page_limit * PGSIZE >= (size_t) PHYS_BASE)
+    limit = (uint8_t *) PGSIZE;
+  if (bottom < limit || bottom >= (uint8_t *) pt->stack_bottom)
+    return false;
+
+  // Grow from the current bottom down, so that the stack stays contiguous
+  for (addr = (uint8_t *) pt->stack_bottom - PGSIZE; addr >= bottom;
+       addr -= PGSIZE) {
+    if (get_page_entry(addr) != NULL)
+      return false;
+
+    struct page_entry *entry = allocate_page(addr);
+    if (entry == NULL || !load_page_entry(entry))
+      return false;
+    pt->stack_bottom = addr;
+  }
+  vmstat_count(VMSTAT_STACK_GROW);
+  return true;
+}
+
+/// Return how many bytes of the user buffer [UADDR, UADDR + SIZE) fit in
+/// one page_pin_range() call, i.e. span at most frame_pin_max() pages
+size_t page_pin_chunk(const void *uaddr, size_t size)
+{
+  size_t room = frame_pin_max() * PGSIZE - pg_ofs(uaddr);
+  return size < room ? size : room;
+}
+
+/// Bring every page of the user buffer [UADDR, UADDR + SIZE) into memory and
+/// pin its frame, so that the kernel can access the buffer without faulting,
+/// e.g. while it holds file system locks. If WRITE, the buffer is made
+/// writable first. Return false if part of the buffer does not belong to
+/// the process, in which case nothing is left pinned.
+///
+/// Stack pages not allocated yet are, as on a fault, if they lie at most 32
+/// bytes below ESP, the user stack pointer at system call entry.
+///
+/// The buffer may span at most frame_pin_max() pages, see page_pin_chunk().
+/// Waits until the frame table can spare that many pinned frames, so the
+/// caller must not already hold pins from this function.
+bool page_pin_range(const void *uaddr, size_t size, bool write,
+                    const void *esp)
+{
+  uint8_t *start = pg_round_down(uaddr);
+  uint8_t *end = (uint8_t *) uaddr + size;
+  uint8_t *page;
+
+  if (size == 0)
+    return true;
+  if (end < (uint8_t *) uaddr || !is_user_vaddr(end - 1))
+    return false;
+  ASSERT(size <= page_pin_chunk(uaddr, size));
+
+  frame_reserve_pins();
+
+  for (page = start; page < end; page += PGSIZE) {
+    struct page_entry *entry = get_page_entry(page);
+    uint8_t *low = page > (uint8_t *) uaddr ? page : (uint8_t *) uaddr;
+    bool pinned = false;
+
+    // A buffer on the stack may reach below what the process touched
+    if (entry == NULL && low >= (const uint8_t *) esp - 32 &&
+        page_grow_stack(page))
+      entry = get_page_entry(page);
+
+    if (entry == NULL || (write && !entry->writable)) {
+      unpin_pages(start, page - start);
+      frame_release_pins();
+      return false;
+    }
+
+    // The zero frame is never evicted: reading it needs no pinning
+    if (!write && entry->zero)
+      continue;
+
+    // The copy must not land in a frame other processes share
+    if (write && entry->cow)
+      page_break_cow(page);
+
+    // Eviction runs under paging_sema, so a frame seen there stays put
+    while (!pinned) {
+      sema_down(&paging_sema);
+      if (is_present(entry)) {
+        enum intr_level old_level = intr_disable();
+        pin_frame(entry->frame);
+        intr_set_level(old_level);
+        pinned = true;
+      }
+      sema_up(&paging_sema);
+
+      if (!pinned && !load_page_entry(entry)) {
+        unpin_pages(start, page - start);
+        frame_release_pins();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Unpin the frames of the user buffer [UADDR, UADDR + SIZE) pinned by
+/// page_pin_range()
+void page_unpin_range(const void *uaddr, size_t size)
+{
+  if (size == 0)
+    return;
+
+  unpin_pages(uaddr, size);
+  frame_release_pins();
+}
+
+/// Unpin the frames of the pages of [UADDR, UADDR + SIZE)
+static void unpin_pages(const void *uaddr, size_t size)
+{
+  uint8_t *end = (uint8_t *) uaddr + size;
+  uint8_t *page;
+
+  for (page = pg_round_down(uaddr); page < end; page += PGSIZE) {
+    struct page_entry *entry = get_page_entry(page);
+
+    enum intr_level old_level = intr_disable();
+    if (entry != NULL && entry->frame != NULL)
+      unpin_frame(entry->frame);
+    intr_set_level(old_level);
+  }
+}
+
+/// Give the current process a private, writable copy of the copy-on-write
+/// page containing UADDR, or a frame of its own if it maps the zero frame.
+/// Return false if the page is neither.
+bool page_break_cow(void *uaddr) {
+  struct page_entry *entry = get_page_entry(uaddr);
+  if (entry != NULL && entry->zero && entry->writable) {
+    vmstat_count(VMSTAT_FAULT_COW);
+    return load_page_entry(entry);
+  }
+  if (entry == NULL || !entry->cow || !entry->writable)
+    return false;
+  vmstat_count(VMSTAT_FAULT_COW);
+
+  sema_down(&paging_sema);
+  struct thread *t = thread_current();
+  bool success = false;
+
+  if (entry->frame == NULL) {
+    // Evicted in the meantime: the next fault loads a private copy
+    entry->cow = false;
+    success = true;
+  }
+  else if (entry->share == NULL || share_privatize(entry)) {
+    // Nobody else maps the frame: just make it writable
+    struct frame *fp = entry->frame;
+    enum intr_level old_level = intr_disable();
+    pin_frame(fp);
+    pagedir_clear_page(t->pagedir, entry->uaddr);
+    intr_set_level(old_level);
+
+    entry->cow = false;
+    success = install_frame(fp, true);
+
+    old_level = intr_disable();
+    if (success)
+      unpin_frame(fp);
+    intr_set_level(old_level);
+  }
+  else {
+    // Copy the shared frame into a new one. The old frame stays pinned and
+    // listed as ours until the copy is done so that nobody can free it.
+    struct frame *old = entry->frame;
+    enum intr_level old_level = intr_disable();
+    pin_frame(old);
+    intr_set_level(old_level);
+
+    entry->frame = NULL;
+    struct frame *fp = allocate_frame(entry);
+    ASSERT(fp != NULL);
+
+    old_level = intr_disable();
+    pin_frame(fp);
+    intr_set_level(old_level);
+
+    memcpy(fp->kpage, old->kpage, PGSIZE);
+    pagedir_clear_page(t->pagedir, entry->uaddr);
+
+    old_level = intr_disable();
+    unpin_frame(old);
+    intr_set_level(old_level);
+    share_detach(entry, old);
+
+    entry->cow = false;
+    success = install_frame(fp, true);
+
+    old_level = intr_disable();
+    if (success)
+      unpin_frame(fp);
+    intr_set_level(old_level);
+  }
+
+  sema_up(&paging_sema);
+  return success;
+}
 
 /// Bring a page belonging to this process into main memory from wherever
-/// it is (e.g. swap). Return false if the address does not belong to the
-/// process.
-_Bool load_page(void* uaddr) {
+/// it is (e.g. swap). A read of a page that is all zeros only maps the
+/// shared zero frame; WRITE is true if the access was a write.
+/// Return false if the address does not belong to the process.
+_Bool load_page(void* uaddr, bool write) {
   // Make sure it's supposed to be there
   bool success = false;
   struct page_entry *entry = get_page_entry(uaddr);
   struct thread *t = thread_current();
 
-  if (entry != NULL) {
+  if (entry != NULL && !write && is_zero_fill(entry)) {
+    success = map_zero(entry);
+  }
+  else if (entry != NULL) {
+    bool ws = entry->ws;
     success = load_page_entry(entry);
+    if (success && is_in_fs(entry))
+      fault_around(entry);
+    if (success && ws)
+      prefetch_swap();
   }
 
   return success;
 }
 
+/// Read back the working set pages the current process had when they were
+/// swapped out, after one of them faulted in: the process is likely to
+/// touch the others soon. The slots are read in sector order so that the
+/// disk sees a few sequential sweeps instead of one seek per fault.
+/// Only free frames are used, so that prefetching never evicts pages.
+static void prefetch_swap(void) {
+  struct page_table *pt = &thread_current()->pages;
+  struct page_entry *batch[SWAP_PREFETCH_MAX];
+  size_t limit = frame_free_count();
+  size_t cnt = 0;
+  size_t i, j;
+  struct list_elem *e;
+
+  if (pt->ws_swapped == 0)
+    return;
+  if (limit > SWAP_PREFETCH_MAX)
+    limit = SWAP_PREFETCH_MAX;
+
+  // Collect working set pages that are still on the swap disk
+  for (e = list_begin(&pt->pages); e != list_end(&pt->pages) && cnt < limit;
+       e = list_next(e)) {
+    struct page_entry *entry = list_entry(e, struct page_entry, elem);
+    if (entry->ws && is_swapped(entry) && entry->swap->zentry == NULL)
+      batch[cnt++] = entry;
+  }
+
+  // Sort them by swap sector
+  for (i = 1; i < cnt; i++) {
+    struct page_entry *entry = batch[i];
+    for (j = i; j > 0 && batch[j - 1]->swap->sector > entry->swap->sector; j--)
+      batch[j] = batch[j - 1];
+    batch[j] = entry;
+  }
+
+  for (i = 0; i < cnt; i++) {
+    if (!load_page_entry(batch[i]))
+      break;
+    vmstat_count(VMSTAT_SWAP_PREFETCH);
+  }
+}
+
+/// Forget that ENTRY was swapped out as part of its process' working set
+static void clear_ws(struct page_entry *entry) {
+  if (entry->ws) {
+    struct thread *t = thread_by_tid(entry->tid);
+    if (t != NULL && t->pages.ws_swapped > 0)
+      t->pages.ws_swapped--;
+    entry->ws = false;
+  }
+}
+
+/// Map the file-backed pages following ENTRY, which just faulted in, before
+/// they fault themselves. Pages some other process already holds in memory
+/// are mapped up to FAULT_AROUND_MAX pages ahead since that costs no I/O.
+/// Pages that must be read are only brought in within the current window,
+/// which doubles on every sequential fault and collapses on a random one.
+static void fault_around(struct page_entry *entry) {
+  struct page_table *pt = &thread_current()->pages;
+  uint8_t *uaddr = (uint8_t *) entry->uaddr + PGSIZE;
+  size_t i;
+
+  if (entry->uaddr == pt->next_fault)
+    pt->window = (pt->window == 0) ? FAULT_AROUND_MIN : pt->window * 2;
+  else
+    pt->window = 0;
+  if (pt->window > FAULT_AROUND_MAX)
+    pt->window = FAULT_AROUND_MAX;
+
+  pt->next_fault = uaddr;
+  for (i = 0; i < FAULT_AROUND_MAX; i++, uaddr += PGSIZE) {
+    struct page_entry *next = get_page_entry(uaddr);
+
+    // Stop at the end of the segment or mapping
+    if (next == NULL || !is_in_fs(next) || is_swapped(next))
+      break;
+
+    // Zero pages are cheaper to fault in later
+    if (next->zero || next->read_bytes == 0)
+      continue;
+
+    if (i < pt->window) {
+      if (!is_present(next) && !load_page_entry(next))
+        break;
+      pt->next_fault = uaddr + PGSIZE;
+    }
+    else if (!is_present(next)) {
+      // Past the window only resident pages are worth mapping
+      map_resident(next);
+    }
+  }
+}
+
+/// Map the shared zero frame read-only at ENTRY. The first write to the page
+/// faults and gives it a frame of its own.
+static bool map_zero(struct page_entry *entry) {
+  uint32_t *pd = thread_current()->pagedir;
+  bool success = false;
+
+  sema_down(&paging_sema);
+  if (entry->zero)
+    success = true;
+  else if (is_zero_fill(entry) && pagedir_set_page(pd, entry->uaddr,
+                                                   zero_page, false)) {
+    entry->zero = true;
+    success = true;
+  }
+  sema_up(&paging_sema);
+
+  return success;
+}
+
+/// Remove the zero frame mapping of ENTRY
+static void unmap_zero(struct page_entry *entry) {
+  struct thread *t = thread_by_tid(entry->tid);
+
+  if (t != NULL && t->pagedir != NULL)
+    pagedir_clear_page(t->pagedir, entry->uaddr);
+  entry->zero = false;
+}
+
+/// Map ENTRY if another process already has its data in a frame
+static bool map_resident(struct page_entry *entry) {
+  bool success = false;
+
+  sema_down(&paging_sema);
+  if (!is_present(entry) && share_is_shareable(entry))
+    success = share_map(entry);
+  sema_up(&paging_sema);
+
+  return success;
+}
+
 /// Look in the current thread's page table for page containing UADDR.
 /// Return NULL if there is no such page.
 struct page_entry* get_page_entry(void* uaddr)
@@ -262,12 +776,21 @@ void free_page_entry(struct page_entry* entry)
   enum intr_level old_level = intr_disable();
 
   if (entry != NULL) {
-    if (entry->frame != NULL) {
+    if (entry->zero) {
+      // the zero frame is not ours to free
+      unmap_zero(entry);
+    }
+    if (entry->share != NULL) {
+      // drop our mapping of a shared frame
+      share_release(entry);
+    }
+    else if (entry->frame != NULL) {
       // free the frames the entry points to
       free_frame(entry->frame);
     }
     if (entry->swap != NULL) {
       // free the swap slots the entry points to
+      clear_ws(entry);
       free_swap(entry->swap);
     }
     free(entry);
@@ -292,3 +815,11 @@ bool is_swapped(struct page_entry* entry) {
   ASSERT(entry != NULL);
   return (entry->swap != NULL);
 }
+
+/// Return true if the page would be loaded as all zeros: a page that is
+/// neither in memory nor in swap, and has nothing to read from its file
+bool is_zero_fill(struct page_entry* entry) {
+  ASSERT(entry != NULL);
+  return (!is_present(entry) && !is_swapped(entry) && !entry->mmap &&
+          (entry->file == NULL || entry->read_bytes == 0));
+}
@@ -3,12 +3,49 @@
 
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
+#include "vm/vmstat.h"
 
 #include "lib/kernel/list.h"
 #include "filesys/filesys.h"
 
+/// Fault-around window bounds, in pages past the faulting one
+#define FAULT_AROUND_MIN 1
+#define FAULT_AROUND_MAX 16
+
+/// Most swapped out working set pages read back in on a single fault
+#define SWAP_PREFETCH_MAX 32
+
+/// Most pages of a user buffer that a system call pins at once, unless the
+/// user pool is too small to spare that many
+#define PAGE_PIN_MAX 16
+
+/// Default limit on the size of a user stack, in pages (8 MB)
+#define STACK_MAX_PAGES 2048
+
+extern size_t stack_page_limit;
+
+struct thread;
+
 struct page_table {
   struct list pages;
+
+  // Fault-around state for file-backed pages
+  void *next_fault;         // Page a sequential fault would hit next
+  size_t window;            // Pages to read in past the faulting page
+
+  // Stack region, growing down from PHYS_BASE
+  void *stack_bottom;       // Lowest page of the stack allocated so far
+
+  // Resident set, in frames
+  size_t rss;               // Frames currently owned
+  size_t wss;               // Working set estimated by the last aging sweep
+  size_t ws_sample;         // Working set being counted by the current sweep
+  size_t rss_soft;          // Evict from this process first above this, or 0
+  size_t rss_hard;          // Never own more than this, or 0
+  size_t ws_swapped;        // Working set pages on the swap disk
+
+  struct vmstat stats;      // VM events caused by this process
 };
 
 struct page_entry {
@@ -22,6 +59,14 @@ struct page_entry {
   struct file* file;        // Address of file
   uint64_t offset;          // Offset of the page into the file
   uint32_t read_bytes;      // How many to read from the file starting at offset
+  bool mmap;                // The file, not swap, is the backing store
+  bool zero;                // Mapped read-only to the shared zero frame
+  bool ws;                  // In the working set when swapped out to disk
+
+  // Sharing of file pages between processes
+  bool cow;                 // Writable, but shared until the first write
+  struct share_entry *share;    // Shared frame this page maps, if any
+  struct list_elem share_elem;  // List element for the shared frame
 
   struct list_elem elem;    // List element for thread-based page table
 };
@@ -31,21 +76,31 @@ void page_init(void);
 // Page table operations
 void page_table_init(struct page_table *pt);
 void page_table_destroy(struct page_table* pt);
+bool page_table_fork(struct thread *parent);
 void page_table_print_safe(struct page_table *pt);
 void page_table_print(struct page_table *pt);
 
 // Page operations (for user and kernel processes)
 struct page_entry* allocate_page(void* uaddr);
-bool load_page(void *uaddr);
+bool load_page(void *uaddr, bool write);
 bool load_page_entry(struct page_entry *entry);
+bool page_break_cow(void *uaddr);
+bool page_grow_stack(void *uaddr);
+size_t page_pin_chunk(const void *uaddr, size_t size);
+bool page_pin_range(const void *uaddr, size_t size, bool write,
+                    const void *esp);
+void page_unpin_range(const void *uaddr, size_t size);
 
 
 void free_page(void *uaddr);
+void free_mapped_page(void *uaddr);
+bool page_write_back(struct page_entry *entry);
 
 // Page status query
 bool is_in_fs(struct page_entry *entry);
 bool is_present(struct page_entry *entry);
 bool is_swapped(struct page_entry *entry);
+bool is_zero_fill(struct page_entry *entry);
 
 // Page entry operations (for VM internal operations)
 struct page_entry* get_page_entry(void *uaddr);
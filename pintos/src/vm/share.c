@@ -0,0 +1,395 @@
+/**
+ * The share table lets processes running the same executable map the same
+ * physical frame for a page of that executable, instead of each reading
+ * its own copy from the file system.
+ *
+ * Shared frames are keyed by (inode, offset, read_bytes) and are always
+ * mapped read-only. Pages of read-only segments stay shared for their whole
+ * life. Pages of writable segments are shared copy-on-write: the first
+ * write fault gives the writer a private copy (see page_break_cow()).
+ *
+ * Evicting a shared frame unmaps it from every process; since its content
+ * always matches the file, nothing needs to be written back.
+ *
+ * fork() shares the private frames of the parent with the child the same
+ * way, copy-on-write. Such anonymous shared frames have no key and are not
+ * in the share table, and their content exists nowhere else: evicting one
+ * writes a swap copy for every process mapping it.
+ */
+#include "vm/share.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+#include "userprog/pagedir.h"
+
+#include "filesys/file.h"
+#include "filesys/inode.h"
+
+#include "lib/debug.h"
+
+#include "threads/thread.h"
+#include "threads/malloc.h"
+#include "threads/interrupt.h"
+
+static struct hash share_table;         // All shared frames in the system
+
+static unsigned share_hash(const struct hash_elem *e, void *aux);
+static bool share_less(const struct hash_elem *a, const struct hash_elem *b,
+                       void *aux);
+static struct share_entry* share_find(struct page_entry *entry);
+static uint32_t* entry_pagedir(struct page_entry *entry);
+
+/// Initialize the share table
+void share_init(void) {
+  hash_init(&share_table, share_hash, share_less, NULL);
+}
+
+/// Return true if ENTRY can be backed by a shared frame: it must come from
+/// a file and be either read-only or still copy-on-write
+bool share_is_shareable(struct page_entry *entry) {
+  ASSERT(entry != NULL);
+  return (entry->file != NULL && entry->swap == NULL &&
+          entry->read_bytes > 0 && (!entry->writable || entry->cow));
+}
+
+/// If another process already has ENTRY's data in a frame, map that frame
+/// read-only into the current process. Return true if successful.
+bool share_map(struct page_entry *entry) {
+  ASSERT(entry != NULL);
+  ASSERT(entry->frame == NULL);
+  bool success = false;
+
+  enum intr_level old_level = intr_disable();
+  struct share_entry *se = share_find(entry);
+
+  if (se != NULL && se->frame != NULL) {
+    struct thread *t = thread_current();
+    if (pagedir_get_page(t->pagedir, entry->uaddr) == NULL &&
+        pagedir_set_page(t->pagedir, entry->uaddr, se->frame->kpage, false)) {
+      entry->frame = se->frame;
+      entry->share = se;
+      list_push_back(&se->pages, &entry->share_elem);
+      success = true;
+    }
+  }
+  intr_set_level(old_level);
+
+  return success;
+}
+
+/// Publish the frame that was just loaded for ENTRY so that other processes
+/// can map it. The caller must map the frame read-only. If the frame cannot
+/// be published, it simply stays private to ENTRY.
+void share_insert(struct page_entry *entry) {
+  ASSERT(entry != NULL);
+  ASSERT(entry->frame != NULL);
+  ASSERT(entry->frame->share == NULL);
+
+  struct share_entry *se = malloc(sizeof(struct share_entry));
+  if (se == NULL)
+    return;
+
+  se->inumber = inode_get_inumber(file_get_inode(entry->file));
+  se->offset = entry->offset;
+  se->read_bytes = entry->read_bytes;
+  se->frame = entry->frame;
+  se->anon = false;
+  list_init(&se->pages);
+
+  enum intr_level old_level = intr_disable();
+  if (hash_insert(&share_table, &se->elem) != NULL) {
+    // Somebody published the same page in the meantime: stay private
+    intr_set_level(old_level);
+    free(se);
+    return;
+  }
+  list_push_back(&se->pages, &entry->share_elem);
+  entry->share = se;
+  entry->frame->share = se;
+  intr_set_level(old_level);
+}
+
+/// Unmap ENTRY from its shared frame. The frame itself is freed along with
+/// the last mapping.
+void share_release(struct page_entry *entry) {
+  ASSERT(entry != NULL);
+  ASSERT(entry->share != NULL);
+
+  enum intr_level old_level = intr_disable();
+  struct share_entry *se = entry->share;
+  struct frame *fp = se->frame;
+  uint32_t *pd = entry_pagedir(entry);
+
+  if (pd != NULL)
+    pagedir_clear_page(pd, entry->uaddr);
+
+  list_remove(&entry->share_elem);
+  entry->share = NULL;
+  entry->frame = NULL;
+
+  if (list_empty(&se->pages)) {
+    // Last user: retire the shared page and hand the frame back to ENTRY
+    // so that free_frame() can release it
+    if (!se->anon)
+      hash_delete(&share_table, &se->elem);
+    free(se);
+
+    fp->share = NULL;
+    frame_set_owner(fp, entry);
+    entry->frame = fp;
+    free_frame(fp);
+  }
+  else if (fp->upage == entry) {
+    // The frame is accounted to its first mapper: pick another one
+    struct page_entry *owner = list_entry(list_front(&se->pages),
+                                          struct page_entry, share_elem);
+    frame_set_owner(fp, owner);
+  }
+  intr_set_level(old_level);
+}
+
+/// If ENTRY is the only page mapping its shared frame, retire the shared
+/// page and make the frame private to ENTRY. Return true if successful,
+/// false if other processes still map the frame.
+bool share_privatize(struct page_entry *entry) {
+  ASSERT(entry != NULL);
+  ASSERT(entry->share != NULL);
+  bool success = false;
+
+  enum intr_level old_level = intr_disable();
+  struct share_entry *se = entry->share;
+  if (list_size(&se->pages) == 1) {
+    if (!se->anon)
+      hash_delete(&share_table, &se->elem);
+    se->frame->share = NULL;
+    frame_set_owner(se->frame, entry);
+    entry->frame = se->frame;
+    entry->share = NULL;
+    free(se);
+    success = true;
+  }
+  intr_set_level(old_level);
+
+  return success;
+}
+
+/// Remove ENTRY from the processes sharing FP, once ENTRY has been given a
+/// private copy of it. Frees FP if nobody else maps it anymore.
+void share_detach(struct page_entry *entry, struct frame *fp) {
+  ASSERT(entry != NULL);
+  ASSERT(entry->share != NULL);
+  ASSERT(fp->share == entry->share);
+
+  enum intr_level old_level = intr_disable();
+  struct share_entry *se = entry->share;
+
+  list_remove(&entry->share_elem);
+  entry->share = NULL;
+
+  if (list_empty(&se->pages)) {
+    // Everybody else went away while we were copying
+    if (!se->anon)
+      hash_delete(&share_table, &se->elem);
+    free(se);
+    fp->share = NULL;
+    frame_set_owner(fp, NULL);
+    free_frame(fp);
+  }
+  else if (fp->upage == entry) {
+    struct page_entry *owner = list_entry(list_front(&se->pages),
+                                          struct page_entry, share_elem);
+    frame_set_owner(fp, owner);
+  }
+  intr_set_level(old_level);
+}
+
+/// Unmap a shared frame from every process mapping it, and retire the
+/// shared page. Used on eviction; the frame is left to the caller.
+void share_unmap_all(struct share_entry *se) {
+  ASSERT(se != NULL);
+
+  enum intr_level old_level = intr_disable();
+  while (!list_empty(&se->pages)) {
+    struct list_elem *e = list_pop_front(&se->pages);
+    struct page_entry *entry = list_entry(e, struct page_entry, share_elem);
+    uint32_t *pd = entry_pagedir(entry);
+
+    if (pd != NULL)
+      pagedir_clear_page(pd, entry->uaddr);
+
+    // Keep the frame's owner linked: the evictor clears it last
+    if (entry != se->frame->upage)
+      entry->frame = NULL;
+    entry->share = NULL;
+  }
+  if (!se->anon)
+    hash_delete(&share_table, &se->elem);
+  se->frame->share = NULL;
+  free(se);
+  intr_set_level(old_level);
+}
+
+/// Share the frame of PARENT, a page of a process being forked, with CHILD,
+/// the same page of the new process. Both are mapped read-only from then
+/// on, and writable pages become copy-on-write. Return false if out of
+/// memory.
+bool share_fork(struct page_entry *parent, struct page_entry *child) {
+  ASSERT(parent != NULL && parent->frame != NULL);
+  ASSERT(child != NULL && child->frame == NULL);
+  ASSERT(parent->share == NULL || parent->share->anon);
+  struct frame *fp = parent->frame;
+  struct share_entry *se = parent->share;
+  bool success = false;
+
+  if (se == NULL) {
+    se = malloc(sizeof(struct share_entry));
+    if (se == NULL)
+      return false;
+    se->inumber = 0;
+    se->offset = 0;
+    se->read_bytes = 0;
+    se->frame = fp;
+    se->anon = true;
+    list_init(&se->pages);
+  }
+
+  enum intr_level old_level = intr_disable();
+  uint32_t *cpd = entry_pagedir(child);
+  if (cpd != NULL &&
+      pagedir_set_page(cpd, child->uaddr, fp->kpage, false)) {
+    if (parent->share == NULL) {
+      // Write protect the parent's mapping. The frame's data is not stored
+      // anywhere else, so it must be written out when evicted.
+      uint32_t *ppd = entry_pagedir(parent);
+      pagedir_clear_page(ppd, parent->uaddr);
+      pagedir_set_page(ppd, parent->uaddr, fp->kpage, false);
+
+      fp->share = se;
+      fp->async_write = true;
+      parent->share = se;
+      parent->cow = parent->writable;
+      list_push_back(&se->pages, &parent->share_elem);
+    }
+    child->frame = fp;
+    child->share = se;
+    child->cow = child->writable;
+    list_push_back(&se->pages, &child->share_elem);
+    success = true;
+  }
+  else if (parent->share == NULL) {
+    free(se);
+  }
+  intr_set_level(old_level);
+
+  return success;
+}
+
+/// Evict a frame shared by forked processes: unmap it from every process,
+/// and give each one but the frame's owner a swap copy of it. The owner's
+/// copy and the frame itself are left to the caller.
+void share_swap_out(struct share_entry *se) {
+  ASSERT(se != NULL && se->anon);
+  struct frame *fp = se->frame;
+  struct list sharers;
+
+  // Unmap everywhere at once, so that nobody writes to the frame anymore
+  list_init(&sharers);
+  enum intr_level old_level = intr_disable();
+  while (!list_empty(&se->pages)) {
+    struct list_elem *e = list_pop_front(&se->pages);
+    struct page_entry *entry = list_entry(e, struct page_entry, share_elem);
+    uint32_t *pd = entry_pagedir(entry);
+
+    if (pd != NULL)
+      pagedir_clear_page(pd, entry->uaddr);
+    entry->share = NULL;
+    entry->cow = false;
+    if (entry != fp->upage) {
+      entry->frame = NULL;
+      list_push_back(&sharers, &entry->share_elem);
+    }
+  }
+  fp->share = NULL;
+  free(se);
+  intr_set_level(old_level);
+
+  while (!list_empty(&sharers)) {
+    struct list_elem *e = list_pop_front(&sharers);
+    struct page_entry *entry = list_entry(e, struct page_entry, share_elem);
+    if (!swap_out(entry, fp->kpage))
+      PANIC("out of swap space");
+  }
+}
+
+/// Return true if any process mapping the shared frame accessed it
+bool share_is_accessed(struct share_entry *se) {
+  ASSERT(se != NULL);
+  struct list_elem *e;
+
+  for (e = list_begin(&se->pages); e != list_end(&se->pages);
+       e = list_next(e)) {
+    struct page_entry *entry = list_entry(e, struct page_entry, share_elem);
+    uint32_t *pd = entry_pagedir(entry);
+
+    if (pd != NULL && pagedir_is_accessed(pd, entry->uaddr))
+      return true;
+  }
+  return false;
+}
+
+/// Set the accessed bit of the shared frame in every process mapping it
+void share_set_accessed(struct share_entry *se, bool accessed) {
+  ASSERT(se != NULL);
+  struct list_elem *e;
+
+  for (e = list_begin(&se->pages); e != list_end(&se->pages);
+       e = list_next(e)) {
+    struct page_entry *entry = list_entry(e, struct page_entry, share_elem);
+    uint32_t *pd = entry_pagedir(entry);
+
+    if (pd != NULL)
+      pagedir_set_accessed(pd, entry->uaddr, accessed);
+  }
+}
+
+/*====================== HASH TABLE HELPER FUNCTIONS ======================*/
+
+/// Hash a shared page by its (inode, offset, read_bytes) key
+static unsigned share_hash(const struct hash_elem *e, void *aux UNUSED) {
+  const struct share_entry *se = hash_entry(e, struct share_entry, elem);
+  return (hash_int(se->inumber) ^ hash_int((int) se->offset) ^
+          hash_int(se->read_bytes));
+}
+
+/// Order shared pages by their (inode, offset, read_bytes) key
+static bool share_less(const struct hash_elem *a, const struct hash_elem *b,
+                       void *aux UNUSED) {
+  const struct share_entry *sa = hash_entry(a, struct share_entry, elem);
+  const struct share_entry *sb = hash_entry(b, struct share_entry, elem);
+
+  if (sa->inumber != sb->inumber)
+    return sa->inumber < sb->inumber;
+  if (sa->offset != sb->offset)
+    return sa->offset < sb->offset;
+  return sa->read_bytes < sb->read_bytes;
+}
+
+/// Look up the shared page holding ENTRY's data. Return NULL if none.
+static struct share_entry* share_find(struct page_entry *entry) {
+  struct share_entry key;
+  struct hash_elem *e;
+
+  key.inumber = inode_get_inumber(file_get_inode(entry->file));
+  key.offset = entry->offset;
+  key.read_bytes = entry->read_bytes;
+
+  e = hash_find(&share_table, &key.elem);
+  return (e != NULL) ? hash_entry(e, struct share_entry, elem) : NULL;
+}
+
+/// Return the page directory of the process owning ENTRY, or NULL
+static uint32_t* entry_pagedir(struct page_entry *entry) {
+  struct thread *t = thread_by_tid(entry->tid);
+  return (t != NULL) ? t->pagedir : NULL;
+}
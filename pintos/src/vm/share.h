@@ -0,0 +1,39 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include "lib/kernel/hash.h"
+#include "lib/kernel/list.h"
+#include "devices/block.h"
+
+struct frame;
+struct page_entry;
+
+/// A read-only file page that may be mapped by several processes at once,
+/// e.g. the code pages of an executable run by many processes.
+struct share_entry {
+  block_sector_t inumber;     // Inode of the backing file
+  uint64_t offset;            // Offset of the page into the file
+  uint32_t read_bytes;        // How many bytes of the page come from the file
+
+  struct frame *frame;        // Frame holding the page
+  struct list pages;          // Page entries currently mapping the frame
+  struct hash_elem elem;      // Element in the global share table
+  bool anon;                  // Memory of forked processes, not in the table
+};
+
+void share_init(void);
+
+bool share_is_shareable(struct page_entry *entry);
+bool share_map(struct page_entry *entry);
+void share_insert(struct page_entry *entry);
+void share_release(struct page_entry *entry);
+bool share_privatize(struct page_entry *entry);
+void share_detach(struct page_entry *entry, struct frame *fp);
+void share_unmap_all(struct share_entry *se);
+bool share_fork(struct page_entry *parent, struct page_entry *child);
+void share_swap_out(struct share_entry *se);
+
+bool share_is_accessed(struct share_entry *se);
+void share_set_accessed(struct share_entry *se, bool accessed);
+
+#endif /* vm/share.h */
@@ -21,12 +21,14 @@
  */
 #include "vm/swap.h"
 #include "vm/frame.h"
+#include "vm/zswap.h"
 
 #include "devices/block.h"
 #include "lib/kernel/list.h"
 #include "lib/debug.h"
 
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
 #include "threads/interrupt.h"
@@ -42,8 +44,9 @@ static struct list swap_list;                      /// list of swap blocks
 /* Forward declaration for internal uses */
 struct swap_slot* get_free_slot(void);
 
-void read_swap(struct swap_slot *slot);
-void write_swap(struct swap_slot *slot);
+void read_swap(struct swap_slot *slot, void *kpage);
+void write_swap(struct swap_slot *slot, const void *kpage);
+static bool push_to_zswap(struct page_entry *upage, const void *kpage);
 
 /** Initalize the swap system */
 void swap_init(void) {
@@ -51,6 +54,7 @@ void swap_init(void) {
   swap_size = (swap_block) ? block_size(swap_block) : 0;
   next_sector = 0;
   list_init(&swap_list);
+  zswap_init();
 }
 
 /// Get a swap slot and write a frame to it
@@ -58,17 +62,32 @@ bool push_to_swap(struct frame* fp)
 {
   ASSERT(fp != NULL);
   ASSERT(fp->upage != NULL);
+  return swap_out(fp->upage, fp->kpage);
+}
+
+/// Get a swap slot for UPAGE and write the page at KPAGE to it. The page
+/// need not be UPAGE's frame, e.g. when processes sharing a frame each get
+/// their own copy of it.
+bool swap_out(struct page_entry *upage, const void *kpage)
+{
+  ASSERT(upage != NULL);
+  ASSERT(upage->swap == NULL);
+
+  // Keep the page compressed in RAM if it compresses well and there's room
+  if (push_to_zswap(upage, kpage))
+    return true;
 
   // Try to get a free slot (will PANIC if no free slot)
   struct swap_slot *slot = get_free_slot();
   if (slot) {
     // Track the swap slot
-    slot->upage = fp->upage;
+    slot->upage = upage;
     slot->upage->swap = slot;
     slot->tid = slot->upage->tid;
 
     // Write data out onto the swap disk
-    write_swap(slot);
+    write_swap(slot, kpage);
+    vmstat_count(VMSTAT_SWAP_OUT);
 
     // Update the CPU-based page directory
     enum intr_level old_level = intr_disable();
@@ -78,17 +97,50 @@ bool push_to_swap(struct frame* fp)
   return (slot != NULL);
 }
 
+/// Compress the page at KPAGE into the compressed swap cache for UPAGE.
+/// Return false if the page does not compress well or the cache is full.
+static bool push_to_zswap(struct page_entry *upage, const void *kpage)
+{
+  struct zswap_entry *ze = zswap_store(kpage);
+  if (ze == NULL)
+    return false;
+
+  struct swap_slot *slot = malloc(sizeof(struct swap_slot));
+  if (slot == NULL) {
+    zswap_free(ze);
+    return false;
+  }
+
+  slot->sector = 0;
+  slot->zentry = ze;
+  slot->upage = upage;
+  slot->upage->swap = slot;
+  slot->tid = slot->upage->tid;
+  vmstat_count(VMSTAT_ZSWAP_OUT);
+  return true;
+}
+
 /// Read a frame from the swap space into main memory. Return false if the
 /// frame cannot be found from the swap slots.
 bool pull_from_swap(struct page_entry *upage)
 {
   ASSERT(upage != NULL);
 
+  // Compressed pages never were on the swap disk
+  if (upage->swap != NULL && upage->swap->zentry != NULL) {
+    struct swap_slot *slot = upage->swap;
+    zswap_load(slot->zentry, upage->frame->kpage);
+    free_swap(slot);
+    vmstat_count(VMSTAT_ZSWAP_IN);
+    return true;
+  }
+
   // Obtain the slot associated with this page
   struct swap_slot *slot = get_swapped_page(upage);
   if (slot != NULL) {
     // Read data in the swap slot into memory
-    read_swap(slot);
+    read_swap(slot, upage->frame->kpage);
+    vmstat_count(VMSTAT_SWAP_IN);
 
     // Update the slot
     slot->upage->swap = NULL;
@@ -105,6 +157,29 @@ bool pull_from_swap(struct page_entry *upage)
   return (slot != NULL);
 }
 
+/// Give TO, a page of a forked process, a swap slot of its own holding a
+/// copy of FROM's swapped out page. Return false if it cannot be copied.
+bool swap_copy(struct page_entry *from, struct page_entry *to)
+{
+  ASSERT(from != NULL && from->swap != NULL);
+  ASSERT(to != NULL);
+  struct swap_slot *slot = from->swap;
+  bool success;
+
+  void *kpage = palloc_get_page(0);
+  if (kpage == NULL)
+    return false;
+
+  if (slot->zentry != NULL)
+    zswap_load(slot->zentry, kpage);
+  else
+    read_swap(slot, kpage);
+  success = swap_out(to, kpage);
+
+  palloc_free_page(kpage);
+  return success;
+}
+
 /// Discard the data in the swap slot, set the slot to free
 void free_swap(struct swap_slot* slot)
 {
@@ -112,7 +187,15 @@ void free_swap(struct swap_slot* slot)
   ASSERT(slot->upage != NULL);
   ASSERT(slot->upage->swap != NULL);
 
-  if (slot != NULL) {
+  if (slot != NULL && slot->zentry != NULL) {
+    // Compressed slots are not on the swap list: just drop them
+    enum intr_level old_level = intr_disable();
+    slot->upage->swap = NULL;
+    zswap_free(slot->zentry);
+    free(slot);
+    intr_set_level(old_level);
+  }
+  else if (slot != NULL) {
     if (slot->upage != NULL) {
       // Remove the page <-> swap slot link
       slot->upage->swap = NULL;
@@ -153,6 +236,7 @@ struct swap_slot* get_free_slot(void)
     if (next_sector < swap_size) {
       slot = malloc(sizeof(struct swap_slot));
       slot->sector = next_sector;
+      slot->zentry = NULL;
       next_sector += (PGSIZE / BLOCK_SECTOR_SIZE);
     }
     else {
@@ -184,19 +268,17 @@ struct swap_slot* get_swapped_page(struct page_entry *upage)
   return NULL;
 }
 
-/** Read the disk sector into the frame; both are pointed to by SLOT.*/
-void read_swap(struct swap_slot* slot)
+/** Read the disk sectors of SLOT into the page at KPAGE.*/
+void read_swap(struct swap_slot* slot, void *kpage)
 {
-  void *kpage = slot->upage->frame->kpage;
   int i;
   for (i = 0; i < PGSIZE / BLOCK_SECTOR_SIZE; i++)
     block_read(swap_block, slot->sector + i, kpage + i * BLOCK_SECTOR_SIZE);
 }
 
-/** Write the frame out into the disk sector; both are pointed to by SLOT.*/
-void write_swap(struct swap_slot* slot)
+/** Write the page at KPAGE out into the disk sectors of SLOT.*/
+void write_swap(struct swap_slot* slot, const void *kpage)
 {
-  void *kpage = slot->upage->frame->kpage;
   int i;
 
   for (i = 0; i < PGSIZE / BLOCK_SECTOR_SIZE; i++) {
@@ -5,18 +5,22 @@
 
 struct frame;
 struct page_entry;
+struct zswap_entry;
 
 struct swap_slot {
   int tid;
   uint32_t sector;
   struct page_entry *upage;
+  struct zswap_entry *zentry;   // Compressed copy in RAM, or NULL if on disk
   struct list_elem elem;
 };
 
 void swap_init(void);
 
 bool push_to_swap(struct frame* fp);
+bool swap_out(struct page_entry *upage, const void *kpage);
 bool pull_from_swap(struct page_entry* upage);
+bool swap_copy(struct page_entry *from, struct page_entry *to);
 
 void free_swap(struct swap_slot* slot);
 
@@ -4,6 +4,9 @@
 #include "vm/frame.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/share.h"
+#include "vm/zswap.h"
+#include "vm/vmstat.h"
 
 /// Initialize all VM subsystems that need initialization
 inline void vm_init(void)
@@ -11,6 +14,7 @@ inline void vm_init(void)
   page_init();
   frame_init();
   swap_init();
+  share_init();
 }
 
 #endif
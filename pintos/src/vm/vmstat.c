@@ -0,0 +1,140 @@
+/**
+ * VM statistics. Every event is counted twice: once for the whole system
+ * and once for the process that caused it, i.e. the running one. Evictions
+ * are thus charged to the process whose fault needed a frame, not to the
+ * owner of the victim.
+ *
+ * Faults are classified as major if the process read a file or the swap
+ * disk while serving them, and minor otherwise. Their service times are
+ * kept in log4 histograms of CPU cycles, separately for both classes, so
+ * that a slowdown can be told apart between the eviction policy (more
+ * faults) and the disk (slower major faults).
+ */
+#include "vm/vmstat.h"
+
+#include <stdio.h>
+#include "lib/debug.h"
+#include "lib/string.h"
+
+#include "threads/thread.h"
+#include "threads/interrupt.h"
+
+/// Set by the "-vmstat" kernel command line option to print the statistics
+/// of every process when it exits
+bool vmstat_at_exit = false;
+
+static struct vmstat global_stats;      // System-wide counters
+
+static const char *lat_names[VMSTAT_LAT_CNT] = {
+  "<4K", "<16K", "<64K", "<256K", "<1M", "<4M", "<16M", ">16M"
+};
+
+static uint64_t read_tsc(void);
+static unsigned long process_io(void);
+static void print_latency(const char *name, const char *kind,
+                          const unsigned long lat[VMSTAT_LAT_CNT]);
+
+/// Clear the counters VS
+void vmstat_init(struct vmstat *vs) {
+  memset(vs, 0, sizeof *vs);
+}
+
+/// Count one ITEM event for the system and the running process
+void vmstat_count(enum vmstat_item item) {
+  ASSERT(item < VMSTAT_CNT);
+
+  enum intr_level old_level = intr_disable();
+  global_stats.count[item]++;
+  thread_current()->pages.stats.count[item]++;
+  intr_set_level(old_level);
+}
+
+/// Start timing a page fault into VF
+void vmstat_fault_begin(struct vmstat_fault *vf) {
+  vf->io = process_io();
+  vf->start = read_tsc();
+}
+
+/// Finish timing the page fault VF, and count it as major if the process
+/// did any I/O since vmstat_fault_begin()
+void vmstat_fault_end(struct vmstat_fault *vf) {
+  uint64_t cycles = read_tsc() - vf->start;
+  bool major = (process_io() != vf->io);
+  uint64_t limit = 4096;
+  int bucket = 0;
+
+  while (bucket < VMSTAT_LAT_CNT - 1 && cycles >= limit) {
+    bucket++;
+    limit *= 4;
+  }
+
+  enum intr_level old_level = intr_disable();
+  struct vmstat *vs = &thread_current()->pages.stats;
+  if (major) {
+    global_stats.count[VMSTAT_FAULT_MAJOR]++;
+    global_stats.major_lat[bucket]++;
+    vs->count[VMSTAT_FAULT_MAJOR]++;
+    vs->major_lat[bucket]++;
+  }
+  else {
+    global_stats.count[VMSTAT_FAULT_MINOR]++;
+    global_stats.minor_lat[bucket]++;
+    vs->count[VMSTAT_FAULT_MINOR]++;
+    vs->minor_lat[bucket]++;
+  }
+  intr_set_level(old_level);
+}
+
+/// Print the counters VS under the heading NAME
+void vmstat_print(const char *name, const struct vmstat *vs) {
+  const unsigned long *c = vs->count;
+
+  printf("VM %s: %lu minor faults, %lu major faults, %lu copy-on-write, "
+         "%lu shared\n", name, c[VMSTAT_FAULT_MINOR], c[VMSTAT_FAULT_MAJOR],
+         c[VMSTAT_FAULT_COW], c[VMSTAT_SHARE_HIT]);
+  printf("VM %s: read %lu file, %lu swap (%lu prefetched), %lu compressed; "
+         "wrote %lu swap, %lu compressed\n", name, c[VMSTAT_FILE_IN],
+         c[VMSTAT_SWAP_IN], c[VMSTAT_SWAP_PREFETCH], c[VMSTAT_ZSWAP_IN],
+         c[VMSTAT_SWAP_OUT], c[VMSTAT_ZSWAP_OUT]);
+  printf("VM %s: evicted %lu clean, %lu swapped, %lu to file, %lu zero, "
+         "%lu shared, %lu local\n", name, c[VMSTAT_EVICT_CLEAN],
+         c[VMSTAT_EVICT_SWAP], c[VMSTAT_EVICT_FILE], c[VMSTAT_EVICT_ZERO],
+         c[VMSTAT_EVICT_SHARED], c[VMSTAT_EVICT_LOCAL]);
+  printf("VM %s: clock scanned %lu frames in %lu revolutions, "
+         "%lu stack extensions\n", name, c[VMSTAT_CLOCK_SCAN],
+         c[VMSTAT_CLOCK_REVOLUTION], c[VMSTAT_STACK_GROW]);
+
+  if (c[VMSTAT_FAULT_MINOR] > 0)
+    print_latency(name, "minor", vs->minor_lat);
+  if (c[VMSTAT_FAULT_MAJOR] > 0)
+    print_latency(name, "major", vs->major_lat);
+}
+
+/// Print the system-wide counters
+void vmstat_print_global(void) {
+  vmstat_print("total", &global_stats);
+}
+
+/// Print the latency histogram LAT of KIND faults
+static void print_latency(const char *name, const char *kind,
+                          const unsigned long lat[VMSTAT_LAT_CNT]) {
+  int i;
+
+  printf("VM %s: %s fault cycles:", name, kind);
+  for (i = 0; i < VMSTAT_LAT_CNT; i++)
+    printf(" %s %lu", lat_names[i], lat[i]);
+  printf("\n");
+}
+
+/// Return the number of pages the running process read from files or swap
+static unsigned long process_io(void) {
+  const unsigned long *c = thread_current()->pages.stats.count;
+  return c[VMSTAT_FILE_IN] + c[VMSTAT_SWAP_IN];
+}
+
+/// Read the CPU time stamp counter
+static uint64_t read_tsc(void) {
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
@@ -0,0 +1,59 @@
+#ifndef VM_VMSTAT_H
+#define VM_VMSTAT_H
+
+#include <stdint.h>
+#include "lib/stdbool.h"
+
+/// Events counted by the VM statistics
+enum vmstat_item {
+  VMSTAT_FAULT_MINOR,         // Page faults served without I/O
+  VMSTAT_FAULT_MAJOR,         // Page faults that read the swap disk or a file
+  VMSTAT_FAULT_COW,           // Copy-on-write and zero page breaks
+  VMSTAT_SHARE_HIT,           // Pages mapped from another process' frame
+  VMSTAT_FILE_IN,             // Pages read from a file
+  VMSTAT_SWAP_IN,             // Pages read from the swap disk
+  VMSTAT_SWAP_PREFETCH,       // Pages read from the swap disk before use
+  VMSTAT_ZSWAP_IN,            // Pages decompressed from the swap cache
+  VMSTAT_SWAP_OUT,            // Pages written to the swap disk
+  VMSTAT_ZSWAP_OUT,           // Pages compressed into the swap cache
+  VMSTAT_EVICT_CLEAN,         // Evictions dropping a clean page
+  VMSTAT_EVICT_SWAP,          // Evictions writing a page to swap
+  VMSTAT_EVICT_FILE,          // Evictions writing a page back to its file
+  VMSTAT_EVICT_ZERO,          // Evictions turning an all-zero page into zero fill
+  VMSTAT_EVICT_SHARED,        // Evictions of frames shared by processes
+  VMSTAT_EVICT_LOCAL,         // Evictions of a process at its hard limit
+  VMSTAT_CLOCK_SCAN,          // Frames examined by the clock hand
+  VMSTAT_CLOCK_REVOLUTION,    // Full turns of the clock hand
+  VMSTAT_STACK_GROW,          // Stack extensions
+  VMSTAT_CNT
+};
+
+/// Fault service latency buckets, in CPU cycles: below 4K, 16K, ... 16M,
+/// and above
+#define VMSTAT_LAT_CNT 8
+
+/// A set of VM counters, kept for the whole system and for every process
+struct vmstat {
+  unsigned long count[VMSTAT_CNT];
+  unsigned long minor_lat[VMSTAT_LAT_CNT];  // Minor fault latencies
+  unsigned long major_lat[VMSTAT_LAT_CNT];  // Major fault latencies
+};
+
+/// State of a page fault being timed
+struct vmstat_fault {
+  uint64_t start;             // Time stamp counter at the start
+  unsigned long io;           // I/O done by the process at the start
+};
+
+extern bool vmstat_at_exit;
+
+void vmstat_init(struct vmstat *vs);
+void vmstat_count(enum vmstat_item item);
+
+void vmstat_fault_begin(struct vmstat_fault *vf);
+void vmstat_fault_end(struct vmstat_fault *vf);
+
+void vmstat_print(const char *name, const struct vmstat *vs);
+void vmstat_print_global(void);
+
+#endif /* vm/vmstat.h */
@@ -0,0 +1,184 @@
+/**
+ * The compressed swap cache sits in front of the swap device. An evicted
+ * page is first compressed into a pool of kernel pages; only pages that
+ * do not compress well, or that do not fit in the pool anymore, are
+ * written to the swap disk.
+ *
+ * The pool is managed like Linux' zbud: each pool page holds at most two
+ * compressed pages, one growing from its start and one from its end. This
+ * wastes some space but keeps allocation and freeing trivial.
+ */
+#include "vm/zswap.h"
+
+#include "lib/kernel/lz.h"
+#include "lib/debug.h"
+#include "lib/string.h"
+#include "lib/kernel/list.h"
+
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "threads/interrupt.h"
+
+/// Largest compressed size worth keeping in RAM
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/// A pool page holding up to two compressed pages
+struct zswap_page {
+  uint8_t *base;              // Kernel page holding the data
+  size_t first;               // Bytes used at the start of the page
+  size_t last;                // Bytes used at the end of the page
+  struct list_elem elem;      // List element for the pool
+};
+
+/// A compressed page
+struct zswap_entry {
+  struct zswap_page *zpage;   // Pool page holding the data
+  bool last;                  // True if stored at the end of the pool page
+  size_t size;                // Compressed size in bytes
+};
+
+/// Pool size limit in pages, set by the "-zswap" kernel command line option
+size_t zswap_page_limit = ZSWAP_PAGES;
+
+static struct list pool;                // All pool pages
+static size_t pool_pages;               // Number of pages in the pool
+
+// Compression scratch space. zswap_store() only runs with paging_sema held,
+// by eviction and by fork's swap_copy(), so a single copy is enough.
+static uint8_t zbuf[PGSIZE];
+static uint16_t ztable[LZ_HASH_SIZE];
+
+static struct zswap_page* find_room(size_t size);
+static struct zswap_page* grow_pool(struct zswap_entry *ze, size_t size);
+static void claim_room(struct zswap_page *zp, struct zswap_entry *ze,
+                       size_t size);
+
+/// Initialize the compressed swap cache
+void zswap_init(void) {
+  list_init(&pool);
+  pool_pages = 0;
+}
+
+/// Compress the page at KPAGE into the pool. Return NULL if the page does
+/// not compress well enough or the pool is full.
+struct zswap_entry* zswap_store(const void *kpage) {
+  ASSERT(kpage != NULL);
+
+  size_t size = lz_compress(kpage, PGSIZE, zbuf, ZSWAP_MAX_SIZE, ztable);
+  if (size == 0)
+    return NULL;
+
+  struct zswap_entry *ze = malloc(sizeof(struct zswap_entry));
+  if (ze == NULL)
+    return NULL;
+
+  // Claim a side of the pool page before copying into it. The other side
+  // may be freed by an exiting process at any time, and the pool page with
+  // it unless our side is already claimed.
+  enum intr_level old_level = intr_disable();
+  struct zswap_page *zp = find_room(size);
+  if (zp != NULL)
+    claim_room(zp, ze, size);
+  intr_set_level(old_level);
+
+  if (zp == NULL)
+    zp = grow_pool(ze, size);
+  if (zp == NULL) {
+    free(ze);
+    return NULL;
+  }
+
+  memcpy(ze->last ? zp->base + PGSIZE - size : zp->base, zbuf, size);
+  return ze;
+}
+
+/// Decompress the page stored in ZE into KPAGE. ZE stays allocated.
+void zswap_load(struct zswap_entry *ze, void *kpage) {
+  ASSERT(ze != NULL);
+  ASSERT(kpage != NULL);
+
+  struct zswap_page *zp = ze->zpage;
+  const uint8_t *data = ze->last ? zp->base + PGSIZE - ze->size : zp->base;
+  size_t size = lz_decompress(data, ze->size, kpage, PGSIZE);
+
+  ASSERT(size == PGSIZE);
+}
+
+/// Release the pool space used by ZE and free ZE. The pool page goes back
+/// to the kernel once both of its halves are free.
+void zswap_free(struct zswap_entry *ze) {
+  ASSERT(ze != NULL);
+
+  enum intr_level old_level = intr_disable();
+  struct zswap_page *zp = ze->zpage;
+  if (ze->last)
+    zp->last = 0;
+  else
+    zp->first = 0;
+
+  if (zp->first == 0 && zp->last == 0) {
+    list_remove(&zp->elem);
+    pool_pages--;
+    palloc_free_page(zp->base);
+    free(zp);
+  }
+  intr_set_level(old_level);
+  free(ze);
+}
+
+/// Return a pool page with a free side large enough for SIZE bytes, or
+/// NULL if there is none. Interrupts must be off.
+static struct zswap_page* find_room(size_t size) {
+  struct list_elem *e;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (e = list_begin(&pool); e != list_end(&pool); e = list_next(e)) {
+    struct zswap_page *zp = list_entry(e, struct zswap_page, elem);
+    if ((zp->first == 0 || zp->last == 0) &&
+        zp->first + zp->last + size <= PGSIZE)
+      return zp;
+  }
+  return NULL;
+}
+
+/// Store SIZE bytes of ZE in a free side of ZP. Interrupts must be off.
+static void claim_room(struct zswap_page *zp, struct zswap_entry *ze,
+                       size_t size) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  ze->zpage = zp;
+  ze->size = size;
+  ze->last = (zp->first != 0);
+  if (ze->last)
+    zp->last = size;
+  else
+    zp->first = size;
+}
+
+/// Add a page to the pool with ZE's SIZE bytes claimed in it, and return
+/// it. Return NULL if the pool is at its size limit or the kernel pool is
+/// exhausted.
+static struct zswap_page* grow_pool(struct zswap_entry *ze, size_t size) {
+  if (pool_pages >= zswap_page_limit)
+    return NULL;
+
+  struct zswap_page *zp = malloc(sizeof(struct zswap_page));
+  if (zp == NULL)
+    return NULL;
+  zp->base = palloc_get_page(0);
+  if (zp->base == NULL) {
+    free(zp);
+    return NULL;
+  }
+  zp->first = 0;
+  zp->last = 0;
+
+  enum intr_level old_level = intr_disable();
+  claim_room(zp, ze, size);
+  list_push_back(&pool, &zp->elem);
+  pool_pages++;
+  intr_set_level(old_level);
+  return zp;
+}
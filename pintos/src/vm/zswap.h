@@ -0,0 +1,20 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stddef.h>
+#include "lib/stdbool.h"
+
+/// Default size of the compressed page pool, in kernel pages
+#define ZSWAP_PAGES 64
+
+extern size_t zswap_page_limit;
+
+struct zswap_entry;
+
+void zswap_init(void);
+
+struct zswap_entry* zswap_store(const void *kpage);
+void zswap_load(struct zswap_entry *ze, void *kpage);
+void zswap_free(struct zswap_entry *ze);
+
+#endif /* vm/zswap.h */